@@ -0,0 +1,373 @@
+#include "be_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace be {
+	namespace renderer {
+
+		static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+		}
+
+		static VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return alignment > 1 ? value / alignment * alignment : value;
+		}
+
+		void BeAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device)
+		{
+			this->physicalDevice = physicalDevice;
+			this->device = device;
+
+			vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+			VkPhysicalDeviceProperties deviceProps;
+			vkGetPhysicalDeviceProperties(physicalDevice, &deviceProps);
+			bufferImageGranularity = std::max<VkDeviceSize>(deviceProps.limits.bufferImageGranularity, 1);
+			nonCoherentAtomSize = std::max<VkDeviceSize>(deviceProps.limits.nonCoherentAtomSize, 1);
+			maxMemoryAllocationCount = deviceProps.limits.maxMemoryAllocationCount;
+		}
+
+		void BeAllocator::destroy()
+		{
+			for (auto& block : blocks)
+			{
+				if (block)
+					destroyBlock(*block);
+			}
+			blocks.clear();
+		}
+
+		Allocation BeAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimalImage)
+		{
+			uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+			bool hostVisible = memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+			// Keep linear and optimal resources apart when the device has a coarse buffer/image granularity
+			bool separateImages = optimalImage && bufferImageGranularity > 1;
+
+			VkDeviceSize blockSize = hostVisible ? HOST_BLOCK_SIZE : DEVICE_BLOCK_SIZE;
+			VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+			totalAllocations++;
+
+			if (requirements.size > blockSize / 2)
+			{
+				size_t index = createBlock(requirements.size, memoryType);
+				Block& block = *blocks[index];
+				block.dedicated = true;
+				block.optimalImage = separateImages;
+				block.liveAllocations = 1;
+				block.usedBytes = requirements.size;
+
+				return makeAllocation(block, index, 0, requirements.size);
+			}
+
+			for (size_t i = 0; i < blocks.size(); i++)
+			{
+				Block* block = blocks[i].get();
+				if (!block || block->dedicated || block->memoryType != memoryType || block->optimalImage != separateImages)
+					continue;
+
+				VkDeviceSize offset;
+				if (allocateFromBlock(*block, requirements.size, alignment, offset))
+					return makeAllocation(*block, i, offset, requirements.size);
+			}
+
+			size_t index = createBlock(blockSize, memoryType);
+			Block& block = *blocks[index];
+			block.optimalImage = separateImages;
+			insertFreeRange(block, 0, blockSize);
+
+			VkDeviceSize offset;
+			if (!allocateFromBlock(block, requirements.size, alignment, offset))
+				throw std::runtime_error("Failed to suballocate from a fresh memory block");
+
+			return makeAllocation(block, index, offset, requirements.size);
+		}
+
+		void BeAllocator::free(Allocation& allocation)
+		{
+			if (allocation.memory == VK_NULL_HANDLE)
+				return;
+
+			Block& block = *blocks[allocation.block];
+			block.liveAllocations--;
+			block.usedBytes -= allocation.size;
+
+			if (block.dedicated)
+			{
+				destroyBlock(block);
+				blocks[allocation.block].reset();
+			}
+			else
+			{
+				releaseToBlock(block, allocation.offset, allocation.size);
+
+				// Keep one empty block per memory type around to absorb allocate/free churn
+				if (block.liveAllocations == 0)
+				{
+					for (size_t i = 0; i < blocks.size(); i++)
+					{
+						const Block* other = blocks[i].get();
+						if (i != allocation.block && other && !other->dedicated && other->memoryType == block.memoryType && other->optimalImage == block.optimalImage)
+						{
+							destroyBlock(block);
+							blocks[allocation.block].reset();
+							break;
+						}
+					}
+				}
+			}
+
+			allocation = {};
+		}
+
+		void BeAllocator::createBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation)
+		{
+			if (vkCreateBuffer(device, &createInfo, nullptr, &buffer) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create buffer");
+
+			VkMemoryRequirements memRequirements;
+			vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+			allocation = allocate(memRequirements, properties);
+			vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+		}
+
+		void BeAllocator::createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation)
+		{
+			if (vkCreateImage(device, &createInfo, nullptr, &image) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create image");
+
+			VkMemoryRequirements memRequirements;
+			vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+			allocation = allocate(memRequirements, properties, createInfo.tiling == VK_IMAGE_TILING_OPTIMAL);
+			vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+		}
+
+		void BeAllocator::destroyBuffer(VkBuffer& buffer, Allocation& allocation)
+		{
+			vkDestroyBuffer(device, buffer, nullptr);
+			buffer = VK_NULL_HANDLE;
+			free(allocation);
+		}
+
+		void BeAllocator::destroyImage(VkImage& image, Allocation& allocation)
+		{
+			vkDestroyImage(device, image, nullptr);
+			image = VK_NULL_HANDLE;
+			free(allocation);
+		}
+
+		void BeAllocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+		{
+			if (allocation.coherent || allocation.memory == VK_NULL_HANDLE)
+				return;
+
+			VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+			vkFlushMappedMemoryRanges(device, 1, &range);
+		}
+
+		void BeAllocator::invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+		{
+			if (allocation.coherent || allocation.memory == VK_NULL_HANDLE)
+				return;
+
+			VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+			vkInvalidateMappedMemoryRanges(device, 1, &range);
+		}
+
+		VkMappedMemoryRange BeAllocator::mappedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+		{
+			if (size == VK_WHOLE_SIZE)
+				size = allocation.size - offset;
+
+			// Ranges must be multiples of nonCoherentAtomSize, which may spill into neighbours but never past the block
+			VkDeviceSize begin = alignDown(allocation.offset + offset, nonCoherentAtomSize);
+			VkDeviceSize end = alignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+
+			const Block& block = *blocks[allocation.block];
+
+			VkMappedMemoryRange range = {};
+			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range.memory = allocation.memory;
+			range.offset = begin;
+			range.size = end > block.size ? VK_WHOLE_SIZE : end - begin;
+			return range;
+		}
+
+		uint32_t BeAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+		{
+			for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+			{
+				if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+					return i;
+			}
+
+			throw std::runtime_error("Failed to find suitable memory type");
+		}
+
+		AllocatorStats BeAllocator::stats() const
+		{
+			AllocatorStats result;
+			result.deviceAllocations = deviceAllocations;
+			result.maxDeviceAllocations = maxMemoryAllocationCount;
+			result.totalAllocations = totalAllocations;
+
+			for (const auto& block : blocks)
+			{
+				if (!block)
+					continue;
+
+				result.reservedBytes += block->size;
+				result.usedBytes += block->usedBytes;
+				result.liveAllocations += block->liveAllocations;
+				result.freeRanges += static_cast<uint32_t>(block->freeByOffset.size());
+
+				if (!block->freeBySize.empty())
+					result.largestFreeRange = std::max(result.largestFreeRange, block->freeBySize.rbegin()->first);
+			}
+
+			return result;
+		}
+
+		size_t BeAllocator::createBlock(VkDeviceSize size, uint32_t memoryType)
+		{
+			VkMemoryAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = size;
+			allocInfo.memoryTypeIndex = memoryType;
+
+			auto block = std::make_unique<Block>();
+			if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+				throw std::runtime_error("Failed to allocate device memory block");
+
+			deviceAllocations++;
+			block->size = size;
+			block->memoryType = memoryType;
+
+			if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			{
+				if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+				{
+					// The block isn't in blocks yet, so destroy won't free it
+					vkFreeMemory(device, block->memory, nullptr);
+					deviceAllocations--;
+					throw std::runtime_error("Failed to map device memory block");
+				}
+			}
+
+			for (size_t i = 0; i < blocks.size(); i++)
+			{
+				if (!blocks[i])
+				{
+					blocks[i] = std::move(block);
+					return i;
+				}
+			}
+
+			blocks.push_back(std::move(block));
+			return blocks.size() - 1;
+		}
+
+		void BeAllocator::destroyBlock(Block& block)
+		{
+			if (block.mapped)
+				vkUnmapMemory(device, block.memory);
+
+			vkFreeMemory(device, block.memory, nullptr);
+			deviceAllocations--;
+		}
+
+		bool BeAllocator::allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+		{
+			for (auto it = block.freeBySize.lower_bound(size); it != block.freeBySize.end(); ++it)
+			{
+				VkDeviceSize rangeOffset = it->second;
+				VkDeviceSize rangeSize = it->first;
+				VkDeviceSize alignedOffset = alignUp(rangeOffset, alignment);
+
+				if (alignedOffset + size > rangeOffset + rangeSize)
+					continue;
+
+				eraseFreeRange(block, block.freeByOffset.find(rangeOffset));
+
+				if (alignedOffset > rangeOffset)
+					insertFreeRange(block, rangeOffset, alignedOffset - rangeOffset);
+				if (alignedOffset + size < rangeOffset + rangeSize)
+					insertFreeRange(block, alignedOffset + size, rangeOffset + rangeSize - alignedOffset - size);
+
+				block.liveAllocations++;
+				block.usedBytes += size;
+				offset = alignedOffset;
+				return true;
+			}
+
+			return false;
+		}
+
+		void BeAllocator::releaseToBlock(Block& block, VkDeviceSize offset, VkDeviceSize size)
+		{
+			auto next = block.freeByOffset.lower_bound(offset);
+
+			if (next != block.freeByOffset.end() && offset + size == next->first)
+			{
+				size += next->second;
+				eraseFreeRange(block, next);
+			}
+
+			auto prev = block.freeByOffset.lower_bound(offset);
+			if (prev != block.freeByOffset.begin())
+			{
+				--prev;
+				if (prev->first + prev->second == offset)
+				{
+					offset = prev->first;
+					size += prev->second;
+					eraseFreeRange(block, prev);
+				}
+			}
+
+			insertFreeRange(block, offset, size);
+		}
+
+		void BeAllocator::insertFreeRange(Block& block, VkDeviceSize offset, VkDeviceSize size)
+		{
+			block.freeByOffset[offset] = size;
+			block.freeBySize.insert(std::make_pair(size, offset));
+		}
+
+		void BeAllocator::eraseFreeRange(Block& block, std::map<VkDeviceSize, VkDeviceSize>::iterator it)
+		{
+			auto range = block.freeBySize.equal_range(it->second);
+			for (auto sizeIt = range.first; sizeIt != range.second; ++sizeIt)
+			{
+				if (sizeIt->second == it->first)
+				{
+					block.freeBySize.erase(sizeIt);
+					break;
+				}
+			}
+
+			block.freeByOffset.erase(it);
+		}
+
+		Allocation BeAllocator::makeAllocation(const Block& block, size_t blockIndex, VkDeviceSize offset, VkDeviceSize size) const
+		{
+			Allocation allocation;
+			allocation.memory = block.memory;
+			allocation.offset = offset;
+			allocation.size = size;
+			allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+			allocation.memoryType = block.memoryType;
+			allocation.coherent = (memoryProperties.memoryTypes[block.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+			allocation.block = blockIndex;
+
+			return allocation;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <map>
+#include <memory>
+
+namespace be
+{
+	namespace renderer {
+
+		struct Allocation
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			// Host visible memory stays mapped for the whole lifetime of its block
+			void* mapped = nullptr;
+			uint32_t memoryType = 0;
+			bool coherent = true;
+			size_t block = 0;
+		};
+
+		struct AllocatorStats
+		{
+			uint32_t deviceAllocations = 0;
+			uint32_t maxDeviceAllocations = 0;
+			VkDeviceSize reservedBytes = 0;
+			VkDeviceSize usedBytes = 0;
+			uint32_t liveAllocations = 0;
+			uint64_t totalAllocations = 0;
+			uint32_t freeRanges = 0;
+			VkDeviceSize largestFreeRange = 0;
+		};
+
+		// Suballocates buffers and images out of large VkDeviceMemory blocks, with best fit free lists and
+		// coalescing. Per frame buffers are kept and grown rather than reallocated each frame, so they use
+		// the same lists. Not thread safe.
+		class BeAllocator
+		{
+		public:
+			static constexpr VkDeviceSize DEVICE_BLOCK_SIZE = 64ull * 1024 * 1024;
+			static constexpr VkDeviceSize HOST_BLOCK_SIZE = 16ull * 1024 * 1024;
+
+			void init(VkPhysicalDevice physicalDevice, VkDevice device);
+			void destroy();
+
+			Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimalImage = false);
+			void free(Allocation& allocation);
+
+			void createBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation);
+			void createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation);
+			void destroyBuffer(VkBuffer& buffer, Allocation& allocation);
+			void destroyImage(VkImage& image, Allocation& allocation);
+
+			// Makes host writes visible to the device, no-op for coherent memory
+			void flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+			// Makes device writes visible to the host, no-op for coherent memory
+			void invalidate(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+			uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+			AllocatorStats stats() const;
+
+		private:
+			struct Block
+			{
+				VkDeviceMemory memory = VK_NULL_HANDLE;
+				VkDeviceSize size = 0;
+				void* mapped = nullptr;
+				uint32_t memoryType = 0;
+				bool optimalImage = false;
+				bool dedicated = false;
+
+				// offset -> size, and size -> offset for best fit lookups
+				::std::map<VkDeviceSize, VkDeviceSize> freeByOffset;
+				::std::multimap<VkDeviceSize, VkDeviceSize> freeBySize;
+				uint32_t liveAllocations = 0;
+				VkDeviceSize usedBytes = 0;
+			};
+
+			size_t createBlock(VkDeviceSize size, uint32_t memoryType);
+			void destroyBlock(Block& block);
+
+			bool allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+			void releaseToBlock(Block& block, VkDeviceSize offset, VkDeviceSize size);
+			void insertFreeRange(Block& block, VkDeviceSize offset, VkDeviceSize size);
+			void eraseFreeRange(Block& block, ::std::map<VkDeviceSize, VkDeviceSize>::iterator it);
+
+			VkMappedMemoryRange mappedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+			Allocation makeAllocation(const Block& block, size_t blockIndex, VkDeviceSize offset, VkDeviceSize size) const;
+
+			VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+			VkDevice device = VK_NULL_HANDLE;
+			VkPhysicalDeviceMemoryProperties memoryProperties = {};
+			VkDeviceSize bufferImageGranularity = 1;
+			VkDeviceSize nonCoherentAtomSize = 1;
+			uint32_t maxMemoryAllocationCount = 0;
+
+			// Null entries are free slots, so Allocation::block indices stay valid
+			::std::vector<::std::unique_ptr<Block>> blocks;
+
+			uint32_t deviceAllocations = 0;
+			uint64_t totalAllocations = 0;
+		};
+	}
+}
\ No newline at end of file
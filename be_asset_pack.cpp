@@ -0,0 +1,233 @@
+#include "be_asset_pack.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <stdexcept>
+
+namespace be {
+
+	BeAssetPack::~BeAssetPack()
+	{
+		close();
+	}
+
+	void BeAssetPack::open(const std::string& path)
+	{
+		close();
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Failed to open asset pack " + path);
+
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(file, &fileSize);
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map asset pack " + path);
+		}
+
+		fileHandle = file;
+		mappingHandle = mapping;
+		mappedSize = static_cast<size_t>(fileSize.QuadPart);
+		base = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Failed to open asset pack " + path);
+
+		struct stat fileStat;
+		fstat(fd, &fileStat);
+
+		void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+		fileDescriptor = fd;
+		mappedSize = static_cast<size_t>(fileStat.st_size);
+		base = mapped == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mapped);
+#endif
+
+		if (base == nullptr)
+		{
+			close();
+			throw std::runtime_error("Failed to map asset pack " + path);
+		}
+
+		AssetPackHeader header;
+		if (mappedSize < sizeof(header))
+		{
+			close();
+			throw std::runtime_error("Asset pack is truncated: " + path);
+		}
+
+		memcpy(&header, base, sizeof(header));
+		if (memcmp(header.magic, "BEPK", 4) != 0 || header.version != VERSION
+			|| mappedSize < sizeof(header) + static_cast<size_t>(header.entryCount) * sizeof(AssetPackEntry))
+		{
+			close();
+			throw std::runtime_error("Not a valid asset pack: " + path);
+		}
+
+		entries = reinterpret_cast<const AssetPackEntry*>(base + sizeof(header));
+		entryCount = header.entryCount;
+
+		for (uint32_t i = 0; i < entryCount; i++)
+		{
+			if (static_cast<size_t>(entries[i].offset) + entries[i].size > mappedSize || entries[i].offset % 4 != 0)
+			{
+				close();
+				throw std::runtime_error("Asset pack entry out of bounds: " + path);
+			}
+		}
+	}
+
+	void BeAssetPack::close()
+	{
+		decompressed.clear();
+		entries = nullptr;
+		entryCount = 0;
+
+#ifdef _WIN32
+		if (base)
+			UnmapViewOfFile(base);
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+		if (fileHandle)
+			CloseHandle(fileHandle);
+
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+#else
+		if (base)
+			munmap(const_cast<uint8_t*>(base), mappedSize);
+		if (fileDescriptor >= 0)
+			::close(fileDescriptor);
+
+		fileDescriptor = -1;
+#endif
+
+		base = nullptr;
+		mappedSize = 0;
+	}
+
+	AssetView BeAssetPack::get(const std::string& name)
+	{
+		const AssetPackEntry* entry = findEntry(name);
+		if (!entry)
+			throw std::runtime_error("Asset not found in pack: " + name);
+
+		AssetView view;
+		if (!(entry->flags & FLAG_LZ4))
+		{
+			view.data = base + entry->offset;
+			view.size = entry->size;
+			return view;
+		}
+
+		auto& storage = decompressed[name];
+		if (!storage)
+		{
+			auto buffer = std::make_unique<std::vector<uint8_t>>(entry->rawSize);
+			if (!decompressLz4Block(base + entry->offset, entry->size, buffer->data(), buffer->size()))
+				throw std::runtime_error("Corrupt LZ4 data for asset: " + name);
+
+			storage = std::move(buffer);
+		}
+
+		view.data = storage->data();
+		view.size = storage->size();
+		return view;
+	}
+
+	bool BeAssetPack::contains(const std::string& name) const
+	{
+		return findEntry(name) != nullptr;
+	}
+
+	const AssetPackEntry* BeAssetPack::findEntry(const std::string& name) const
+	{
+		for (uint32_t i = 0; i < entryCount; i++)
+		{
+			if (strncmp(entries[i].name, name.c_str(), sizeof(entries[i].name)) == 0)
+				return &entries[i];
+		}
+
+		return nullptr;
+	}
+
+	bool decompressLz4Block(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+	{
+		const uint8_t* ip = src;
+		const uint8_t* ipEnd = src + srcSize;
+		uint8_t* op = dst;
+		uint8_t* opEnd = dst + dstSize;
+
+		auto readLength = [&](size_t length) -> size_t {
+			if (length != 15)
+				return length;
+
+			uint8_t byte;
+			do {
+				if (ip >= ipEnd)
+					return SIZE_MAX;
+				byte = *ip++;
+				length += byte;
+			} while (byte == 255);
+
+			return length;
+		};
+
+		while (ip < ipEnd)
+		{
+			uint8_t token = *ip++;
+
+			size_t literalLength = readLength(token >> 4);
+			if (literalLength == SIZE_MAX || literalLength > static_cast<size_t>(ipEnd - ip) || literalLength > static_cast<size_t>(opEnd - op))
+				return false;
+
+			memcpy(op, ip, literalLength);
+			ip += literalLength;
+			op += literalLength;
+
+			// The last sequence only has literals
+			if (ip >= ipEnd)
+				break;
+
+			if (ipEnd - ip < 2)
+				return false;
+
+			size_t offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+
+			if (offset == 0 || offset > static_cast<size_t>(op - dst))
+				return false;
+
+			size_t matchLength = readLength(token & 15);
+			if (matchLength == SIZE_MAX)
+				return false;
+			matchLength += 4;
+
+			if (matchLength > static_cast<size_t>(opEnd - op))
+				return false;
+
+			// Matches may overlap their own output, so copy byte by byte
+			const uint8_t* match = op - offset;
+			for (size_t i = 0; i < matchLength; i++)
+				op[i] = match[i];
+			op += matchLength;
+		}
+
+		return op == opEnd;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+namespace be
+{
+	// On disk layout, little endian. Entry data starts on a 4 byte boundary so SPIR-V can be used in place.
+	struct AssetPackHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+	};
+
+	struct AssetPackEntry
+	{
+		char name[48];
+		uint32_t offset;
+		uint32_t size;
+		uint32_t rawSize;
+		uint32_t flags;
+	};
+
+	static_assert(sizeof(AssetPackHeader) == 16, "asset pack header layout");
+	static_assert(sizeof(AssetPackEntry) == 64, "asset pack entry layout");
+
+	struct AssetView
+	{
+		const void* data = nullptr;
+		size_t size = 0;
+	};
+
+	// Read only, memory mapped archive built by tools/pack_assets.py. Uncompressed entries are returned as pointers
+	// straight into the mapping, LZ4 entries are decompressed once on first access and kept for the pack's lifetime.
+	class BeAssetPack
+	{
+	public:
+		static constexpr uint32_t VERSION = 1;
+		static constexpr uint32_t FLAG_LZ4 = 1;
+
+		BeAssetPack() = default;
+		BeAssetPack(const BeAssetPack&) = delete;
+		BeAssetPack& operator=(const BeAssetPack&) = delete;
+		~BeAssetPack();
+
+		void open(const std::string& path);
+		void close();
+
+		bool isOpen() const { return base != nullptr; }
+
+		// Throws if the entry does not exist
+		AssetView get(const std::string& name);
+		bool contains(const std::string& name) const;
+
+	private:
+		const AssetPackEntry* findEntry(const std::string& name) const;
+
+		const uint8_t* base = nullptr;
+		size_t mappedSize = 0;
+		const AssetPackEntry* entries = nullptr;
+		uint32_t entryCount = 0;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+
+		std::map<std::string, std::unique_ptr<std::vector<uint8_t>>> decompressed;
+	};
+
+	// Decodes a raw LZ4 block (no frame header). Returns false on malformed input.
+	bool decompressLz4Block(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+}
\ No newline at end of file
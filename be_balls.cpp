@@ -0,0 +1,499 @@
+#include "be_balls.h"
+
+#include <initializer_list>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BE_BALLS_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// MSVC accepts AVX2 intrinsics anywhere, GCC and Clang need the function to be compiled for the target
+#if defined(__GNUC__) || defined(__clang__)
+#define BE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BE_TARGET_AVX2
+#endif
+
+namespace be {
+
+	using namespace pong;
+
+	// Everything a kernel needs for one tick, precomputed so the SIMD versions only broadcast
+	struct StepParams
+	{
+		Fixed top;
+		Fixed bottom;
+		Fixed left;
+		Fixed right;
+		Fixed leftFace;
+		Fixed rightFace;
+		Fixed reach;
+		Fixed paddleY[2];
+	};
+
+	static const Fixed BALL_HALF = BALL_HALF_WIDTH;
+	static const uint32_t BALLS_PER_JOB = 16384;
+
+	static StepParams makeParams(const Fixed paddleY[2])
+	{
+		StepParams params;
+		params.top = -FIXED_ONE + BALL_HALF_HEIGHT;
+		params.bottom = FIXED_ONE - BALL_HALF_HEIGHT;
+		params.left = -FIXED_ONE + BALL_HALF;
+		params.right = FIXED_ONE - BALL_HALF;
+		params.leftFace = -PADDLE_X + PADDLE_HALF_WIDTH;
+		params.rightFace = PADDLE_X - PADDLE_HALF_WIDTH;
+		params.reach = PADDLE_HALF_HEIGHT + BALL_HALF_HEIGHT;
+		params.paddleY[0] = paddleY[0];
+		params.paddleY[1] = paddleY[1];
+		return params;
+	}
+
+	// Reference implementation, the SIMD kernels mirror it operation for operation
+	static void stepScalar(Fixed* x, Fixed* y, Fixed* vx, Fixed* vy, size_t begin, size_t end, const StepParams& p)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			Fixed nvx = vx[i];
+			Fixed nvy = vy[i];
+			Fixed nx = x[i] + nvx;
+			Fixed ny = y[i] + nvy;
+
+			if (ny < p.top)
+			{
+				ny = 2 * p.top - ny;
+				nvy = -nvy;
+			}
+			if (ny > p.bottom)
+			{
+				ny = 2 * p.bottom - ny;
+				nvy = -nvy;
+			}
+
+			// Same crossing test as the main ball: the leading edge passed the paddle face during this tick
+			Fixed leftEdge = nx - BALL_HALF;
+			Fixed leftOffset = ny - p.paddleY[0];
+			if (nvx < 0 && leftEdge <= p.leftFace && leftEdge - nvx > p.leftFace && leftOffset >= -p.reach && leftOffset <= p.reach)
+			{
+				nx = p.leftFace + BALL_HALF;
+				nvx = -nvx;
+			}
+
+			Fixed rightEdge = nx + BALL_HALF;
+			Fixed rightOffset = ny - p.paddleY[1];
+			if (nvx > 0 && rightEdge >= p.rightFace && rightEdge - nvx < p.rightFace && rightOffset >= -p.reach && rightOffset <= p.reach)
+			{
+				nx = p.rightFace - BALL_HALF;
+				nvx = -nvx;
+			}
+
+			if (nx < p.left)
+			{
+				nx = 2 * p.left - nx;
+				nvx = -nvx;
+			}
+			if (nx > p.right)
+			{
+				nx = 2 * p.right - nx;
+				nvx = -nvx;
+			}
+
+			x[i] = nx;
+			y[i] = ny;
+			vx[i] = nvx;
+			vy[i] = nvy;
+		}
+	}
+
+	static void writeScalar(const Fixed* x, const Fixed* y, renderer::QuadInstance* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			out[i].position = glm::vec2(fixedToFloat(x[i]), fixedToFloat(y[i]));
+	}
+
+#ifdef BE_BALLS_X86
+	static inline __m128i select128(__m128i mask, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	static void stepSSE2(Fixed* x, Fixed* y, Fixed* vx, Fixed* vy, size_t count, const StepParams& p)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i half = _mm_set1_epi32(BALL_HALF);
+		const __m128i top = _mm_set1_epi32(p.top), top2 = _mm_set1_epi32(2 * p.top);
+		const __m128i bottom = _mm_set1_epi32(p.bottom), bottom2 = _mm_set1_epi32(2 * p.bottom);
+		const __m128i left = _mm_set1_epi32(p.left), left2 = _mm_set1_epi32(2 * p.left);
+		const __m128i right = _mm_set1_epi32(p.right), right2 = _mm_set1_epi32(2 * p.right);
+		const __m128i leftFace = _mm_set1_epi32(p.leftFace), rightFace = _mm_set1_epi32(p.rightFace);
+		const __m128i leftRest = _mm_set1_epi32(p.leftFace + BALL_HALF), rightRest = _mm_set1_epi32(p.rightFace - BALL_HALF);
+		const __m128i reach = _mm_set1_epi32(p.reach), minusReach = _mm_set1_epi32(-p.reach);
+		const __m128i paddle0 = _mm_set1_epi32(p.paddleY[0]), paddle1 = _mm_set1_epi32(p.paddleY[1]);
+
+		size_t simdEnd = count & ~size_t(3);
+		for (size_t i = 0; i < simdEnd; i += 4)
+		{
+			__m128i nvx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vx + i));
+			__m128i nvy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vy + i));
+			__m128i nx = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)), nvx);
+			__m128i ny = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)), nvy);
+
+			__m128i mask = _mm_cmplt_epi32(ny, top);
+			ny = select128(mask, _mm_sub_epi32(top2, ny), ny);
+			nvy = select128(mask, _mm_sub_epi32(zero, nvy), nvy);
+			mask = _mm_cmpgt_epi32(ny, bottom);
+			ny = select128(mask, _mm_sub_epi32(bottom2, ny), ny);
+			nvy = select128(mask, _mm_sub_epi32(zero, nvy), nvy);
+
+			// a <= b is expressed as !(a > b), a >= b as !(a < b)
+			__m128i edge = _mm_sub_epi32(nx, half);
+			__m128i offset = _mm_sub_epi32(ny, paddle0);
+			mask = _mm_cmplt_epi32(nvx, zero);
+			mask = _mm_andnot_si128(_mm_cmpgt_epi32(edge, leftFace), mask);
+			mask = _mm_and_si128(mask, _mm_cmpgt_epi32(_mm_sub_epi32(edge, nvx), leftFace));
+			mask = _mm_andnot_si128(_mm_cmplt_epi32(offset, minusReach), mask);
+			mask = _mm_andnot_si128(_mm_cmpgt_epi32(offset, reach), mask);
+			nx = select128(mask, leftRest, nx);
+			nvx = select128(mask, _mm_sub_epi32(zero, nvx), nvx);
+
+			edge = _mm_add_epi32(nx, half);
+			offset = _mm_sub_epi32(ny, paddle1);
+			mask = _mm_cmpgt_epi32(nvx, zero);
+			mask = _mm_andnot_si128(_mm_cmplt_epi32(edge, rightFace), mask);
+			mask = _mm_and_si128(mask, _mm_cmplt_epi32(_mm_sub_epi32(edge, nvx), rightFace));
+			mask = _mm_andnot_si128(_mm_cmplt_epi32(offset, minusReach), mask);
+			mask = _mm_andnot_si128(_mm_cmpgt_epi32(offset, reach), mask);
+			nx = select128(mask, rightRest, nx);
+			nvx = select128(mask, _mm_sub_epi32(zero, nvx), nvx);
+
+			mask = _mm_cmplt_epi32(nx, left);
+			nx = select128(mask, _mm_sub_epi32(left2, nx), nx);
+			nvx = select128(mask, _mm_sub_epi32(zero, nvx), nvx);
+			mask = _mm_cmpgt_epi32(nx, right);
+			nx = select128(mask, _mm_sub_epi32(right2, nx), nx);
+			nvx = select128(mask, _mm_sub_epi32(zero, nvx), nvx);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(x + i), nx);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(y + i), ny);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(vx + i), nvx);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(vy + i), nvy);
+		}
+
+		stepScalar(x, y, vx, vy, simdEnd, count, p);
+	}
+
+	static void writeSSE2(const Fixed* x, const Fixed* y, renderer::QuadInstance* out, size_t count)
+	{
+		const __m128 scale = _mm_set1_ps(1.0f / FIXED_ONE);
+
+		size_t simdEnd = count & ~size_t(3);
+		for (size_t i = 0; i < simdEnd; i += 4)
+		{
+			__m128 fx = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i))), scale);
+			__m128 fy = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i))), scale);
+
+			// Interleave into x,y pairs and write each pair into its instance
+			__m128 low = _mm_unpacklo_ps(fx, fy);
+			__m128 high = _mm_unpackhi_ps(fx, fy);
+			_mm_storel_pi(reinterpret_cast<__m64*>(&out[i].position), low);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&out[i + 1].position), low);
+			_mm_storel_pi(reinterpret_cast<__m64*>(&out[i + 2].position), high);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&out[i + 3].position), high);
+		}
+
+		writeScalar(x, y, out, simdEnd, count);
+	}
+
+	BE_TARGET_AVX2 static inline __m256i select256(__m256i mask, __m256i a, __m256i b)
+	{
+		return _mm256_blendv_epi8(b, a, mask);
+	}
+
+	BE_TARGET_AVX2 static void stepAVX2(Fixed* x, Fixed* y, Fixed* vx, Fixed* vy, size_t count, const StepParams& p)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i ones = _mm256_set1_epi32(-1);
+		const __m256i half = _mm256_set1_epi32(BALL_HALF);
+		const __m256i top = _mm256_set1_epi32(p.top), top2 = _mm256_set1_epi32(2 * p.top);
+		const __m256i bottom = _mm256_set1_epi32(p.bottom), bottom2 = _mm256_set1_epi32(2 * p.bottom);
+		const __m256i left = _mm256_set1_epi32(p.left), left2 = _mm256_set1_epi32(2 * p.left);
+		const __m256i right = _mm256_set1_epi32(p.right), right2 = _mm256_set1_epi32(2 * p.right);
+		const __m256i leftFace = _mm256_set1_epi32(p.leftFace), rightFace = _mm256_set1_epi32(p.rightFace);
+		const __m256i leftRest = _mm256_set1_epi32(p.leftFace + BALL_HALF), rightRest = _mm256_set1_epi32(p.rightFace - BALL_HALF);
+		const __m256i reach = _mm256_set1_epi32(p.reach), minusReach = _mm256_set1_epi32(-p.reach);
+		const __m256i paddle0 = _mm256_set1_epi32(p.paddleY[0]), paddle1 = _mm256_set1_epi32(p.paddleY[1]);
+
+		size_t simdEnd = count & ~size_t(7);
+		for (size_t i = 0; i < simdEnd; i += 8)
+		{
+			__m256i nvx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vx + i));
+			__m256i nvy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vy + i));
+			__m256i nx = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)), nvx);
+			__m256i ny = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)), nvy);
+
+			// AVX2 only has a greater than compare, a < b is b > a
+			__m256i mask = _mm256_cmpgt_epi32(top, ny);
+			ny = select256(mask, _mm256_sub_epi32(top2, ny), ny);
+			nvy = select256(mask, _mm256_sub_epi32(zero, nvy), nvy);
+			mask = _mm256_cmpgt_epi32(ny, bottom);
+			ny = select256(mask, _mm256_sub_epi32(bottom2, ny), ny);
+			nvy = select256(mask, _mm256_sub_epi32(zero, nvy), nvy);
+
+			__m256i edge = _mm256_sub_epi32(nx, half);
+			__m256i offset = _mm256_sub_epi32(ny, paddle0);
+			__m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(minusReach, offset), _mm256_cmpgt_epi32(offset, reach));
+			mask = _mm256_cmpgt_epi32(zero, nvx);
+			mask = _mm256_andnot_si256(_mm256_cmpgt_epi32(edge, leftFace), mask);
+			mask = _mm256_and_si256(mask, _mm256_cmpgt_epi32(_mm256_sub_epi32(edge, nvx), leftFace));
+			mask = _mm256_and_si256(mask, _mm256_xor_si256(outside, ones));
+			nx = select256(mask, leftRest, nx);
+			nvx = select256(mask, _mm256_sub_epi32(zero, nvx), nvx);
+
+			edge = _mm256_add_epi32(nx, half);
+			offset = _mm256_sub_epi32(ny, paddle1);
+			outside = _mm256_or_si256(_mm256_cmpgt_epi32(minusReach, offset), _mm256_cmpgt_epi32(offset, reach));
+			mask = _mm256_cmpgt_epi32(nvx, zero);
+			mask = _mm256_andnot_si256(_mm256_cmpgt_epi32(rightFace, edge), mask);
+			mask = _mm256_and_si256(mask, _mm256_cmpgt_epi32(rightFace, _mm256_sub_epi32(edge, nvx)));
+			mask = _mm256_and_si256(mask, _mm256_xor_si256(outside, ones));
+			nx = select256(mask, rightRest, nx);
+			nvx = select256(mask, _mm256_sub_epi32(zero, nvx), nvx);
+
+			mask = _mm256_cmpgt_epi32(left, nx);
+			nx = select256(mask, _mm256_sub_epi32(left2, nx), nx);
+			nvx = select256(mask, _mm256_sub_epi32(zero, nvx), nvx);
+			mask = _mm256_cmpgt_epi32(nx, right);
+			nx = select256(mask, _mm256_sub_epi32(right2, nx), nx);
+			nvx = select256(mask, _mm256_sub_epi32(zero, nvx), nvx);
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i), nx);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(y + i), ny);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(vx + i), nvx);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(vy + i), nvy);
+		}
+
+		stepScalar(x, y, vx, vy, simdEnd, count, p);
+	}
+
+	BE_TARGET_AVX2 static void writeAVX2(const Fixed* x, const Fixed* y, renderer::QuadInstance* out, size_t count)
+	{
+		const __m256 scale = _mm256_set1_ps(1.0f / FIXED_ONE);
+
+		size_t simdEnd = count & ~size_t(7);
+		for (size_t i = 0; i < simdEnd; i += 8)
+		{
+			__m256 fx = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i))), scale);
+			__m256 fy = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i))), scale);
+
+			// Unpacks work per 128 bit lane: low holds pairs 0, 1, 4, 5 and high holds 2, 3, 6, 7
+			__m256 low = _mm256_unpacklo_ps(fx, fy);
+			__m256 high = _mm256_unpackhi_ps(fx, fy);
+			__m128 low0 = _mm256_castps256_ps128(low), low1 = _mm256_extractf128_ps(low, 1);
+			__m128 high0 = _mm256_castps256_ps128(high), high1 = _mm256_extractf128_ps(high, 1);
+
+			_mm_storel_pi(reinterpret_cast<__m64*>(&out[i].position), low0);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&out[i + 1].position), low0);
+			_mm_storel_pi(reinterpret_cast<__m64*>(&out[i + 2].position), high0);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&out[i + 3].position), high0);
+			_mm_storel_pi(reinterpret_cast<__m64*>(&out[i + 4].position), low1);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&out[i + 5].position), low1);
+			_mm_storel_pi(reinterpret_cast<__m64*>(&out[i + 6].position), high1);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&out[i + 7].position), high1);
+		}
+
+		writeScalar(x, y, out, simdEnd, count);
+	}
+#endif
+
+	// Runs fn(begin, end) over [0, count) in BALLS_PER_JOB sized ranges, a multiple of every vector width
+	template <typename Fn>
+	static void forEachRange(BeJobSystem* jobs, size_t count, const Fn& fn)
+	{
+		if (jobs == nullptr || count <= BALLS_PER_JOB)
+		{
+			fn(size_t(0), count);
+			return;
+		}
+
+		jobs->parallelFor(static_cast<uint32_t>(count), BALLS_PER_JOB, [&](uint32_t begin, uint32_t end) { fn(size_t(begin), size_t(end)); });
+	}
+
+	SimdLevel detectSimdLevel()
+	{
+#ifdef BE_BALLS_X86
+#ifdef _MSC_VER
+		int info[4] = {};
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		// The OS has to save the YMM registers too, not just the CPU support them
+		if (osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+		{
+			__cpuidex(info, 7, 0);
+			if (info[1] & (1 << 5))
+				return SimdLevel::AVX2;
+		}
+		return SimdLevel::SSE2;
+#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return SimdLevel::AVX2;
+		return __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#endif
+#else
+		return SimdLevel::Scalar;
+#endif
+	}
+
+	const char* simdLevelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::AVX2:
+			return "avx2";
+		case SimdLevel::SSE2:
+			return "sse2";
+		default:
+			return "scalar";
+		}
+	}
+
+	void BeBallField::spawn(size_t count, uint32_t seed)
+	{
+		x.resize(count);
+		y.resize(count);
+		vx.resize(count);
+		vy.resize(count);
+
+		// Same xorshift as the main simulation, so a seed always spawns the same field
+		uint32_t state = seed != 0 ? seed : 0x9E3779B9u;
+		auto next = [&state](uint32_t range) {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return static_cast<Fixed>(state % range);
+		};
+
+		const Fixed area = fixedRatio(8, 10);
+		const Fixed minSpeed = fixedRatio(3, 10 * BePongSim::TICK_RATE);
+		const Fixed maxSpeed = fixedRatio(12, 10 * BePongSim::TICK_RATE);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			x[i] = next(2 * area) - area;
+			y[i] = next(2 * area) - area;
+
+			Fixed speedX = minSpeed + next(maxSpeed - minSpeed);
+			Fixed speedY = minSpeed + next(maxSpeed - minSpeed);
+			vx[i] = next(2) ? speedX : -speedX;
+			vy[i] = next(2) ? speedY : -speedY;
+		}
+	}
+
+	uint64_t hashBallField(const BeBallField& field)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (const Fixed* values : { field.positionsX(), field.positionsY(), field.velocitiesX(), field.velocitiesY() })
+		{
+			for (size_t i = 0; i < field.size(); i++)
+			{
+				hash ^= static_cast<uint32_t>(values[i]);
+				hash *= 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	void BeBallField::clear()
+	{
+		x.clear();
+		y.clear();
+		vx.clear();
+		vy.clear();
+	}
+
+	void BeBallField::step(const Fixed paddleY[2], SimdLevel level, BeJobSystem* jobs)
+	{
+		StepParams params = makeParams(paddleY);
+
+		// Balls are independent within a tick, so any split gives the same result
+		forEachRange(jobs, x.size(), [&](size_t begin, size_t end) {
+			Fixed* px = x.data() + begin;
+			Fixed* py = y.data() + begin;
+			Fixed* pvx = vx.data() + begin;
+			Fixed* pvy = vy.data() + begin;
+			size_t count = end - begin;
+
+#ifdef BE_BALLS_X86
+			if (level == SimdLevel::AVX2)
+			{
+				stepAVX2(px, py, pvx, pvy, count, params);
+				return;
+			}
+			if (level == SimdLevel::SSE2)
+			{
+				stepSSE2(px, py, pvx, pvy, count, params);
+				return;
+			}
+#endif
+			stepScalar(px, py, pvx, pvy, 0, count, params);
+		});
+	}
+
+	void BeBallField::collide(const std::vector<BallPair>& pairs)
+	{
+		for (const auto& pair : pairs)
+		{
+			int64_t dx = x[pair.b] - x[pair.a];
+			int64_t dy = y[pair.b] - y[pair.a];
+			int64_t dvx = vx[pair.b] - vx[pair.a];
+			int64_t dvy = vy[pair.b] - vy[pair.a];
+
+			// Balls that are already separating keep their velocities, otherwise they would stick together
+			if (dx * dvx + dy * dvy >= 0)
+				continue;
+
+			std::swap(vx[pair.a], vx[pair.b]);
+			std::swap(vy[pair.a], vy[pair.b]);
+		}
+	}
+
+	void BeBallField::writeInstances(renderer::QuadInstance* out, const glm::vec4& color, SimdLevel level, BeJobSystem* jobs) const
+	{
+		const glm::vec2 size = { 2.0f * fixedToFloat(BALL_HALF_WIDTH), 2.0f * fixedToFloat(BALL_HALF_HEIGHT) };
+		const glm::vec4 uvRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+		forEachRange(jobs, x.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				out[i].size = size;
+				out[i].color = color;
+				out[i].uvRect = uvRect;
+			}
+
+			const Fixed* px = x.data() + begin;
+			const Fixed* py = y.data() + begin;
+			renderer::QuadInstance* rangeOut = out + begin;
+			size_t count = end - begin;
+
+#ifdef BE_BALLS_X86
+			if (level == SimdLevel::AVX2)
+			{
+				writeAVX2(px, py, rangeOut, count);
+				return;
+			}
+			if (level == SimdLevel::SSE2)
+			{
+				writeSSE2(px, py, rangeOut, count);
+				return;
+			}
+#endif
+			writeScalar(px, py, rangeOut, 0, count);
+		});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "be_pong.h"
+#include "be_batch.h"
+#include "be_grid.h"
+#include "be_jobs.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace be
+{
+	enum class SimdLevel
+	{
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	// Best level the CPU and OS support, Scalar on non x86 targets
+	SimdLevel detectSimdLevel();
+	const char* simdLevelName(SimdLevel level);
+
+	class BeBallField;
+	// FNV-1a over every ball's position and velocity, word by word, so large fields stay cheap to hash every tick
+	uint64_t hashBallField(const BeBallField& field);
+
+	// Extra balls for chaos mode, stored as structure of arrays in the same 16.16 fixed point as PongState. Balls
+	// bounce off all four field edges and both paddles, and off each other when collide() is given the overlapping
+	// pairs. Every SIMD level produces exactly the same results as the scalar reference, the kernels only use integer
+	// adds, compares and selects.
+	class BeBallField
+	{
+	public:
+		void spawn(size_t count, uint32_t seed);
+		void clear();
+
+		// Advances every ball by one simulation tick against the given paddle positions, split over the job system if given
+		void step(const Fixed paddleY[2], SimdLevel level, BeJobSystem* jobs = nullptr);
+		// Equal mass bounce for every pair that is still approaching, applied in pair order
+		void collide(const ::std::vector<BallPair>& pairs);
+
+		// Writes one quad per ball, out must have room for size() instances
+		void writeInstances(renderer::QuadInstance* out, const glm::vec4& color, SimdLevel level, BeJobSystem* jobs = nullptr) const;
+
+		size_t size() const { return x.size(); }
+		const Fixed* positionsX() const { return x.data(); }
+		const Fixed* positionsY() const { return y.data(); }
+		const Fixed* velocitiesX() const { return vx.data(); }
+		const Fixed* velocitiesY() const { return vy.data(); }
+
+	private:
+		::std::vector<Fixed> x;
+		::std::vector<Fixed> y;
+		::std::vector<Fixed> vx;
+		::std::vector<Fixed> vy;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "be_batch.h"
+
+#include <string>
+
+namespace be {
+	namespace renderer {
+
+		void BeQuadBatch::submit(glm::vec2 position, glm::vec2 size, glm::vec4 color, glm::vec4 uvRect)
+		{
+			QuadInstance quad;
+			quad.position = position;
+			quad.size = size;
+			quad.color = color;
+			quad.uvRect = uvRect;
+
+			quads.push_back(quad);
+		}
+
+		QuadInstance* BeQuadBatch::allocate(size_t count)
+		{
+			size_t first = quads.size();
+			quads.resize(first + count);
+
+			return quads.data() + first;
+		}
+
+		void BeQuadBatch::submitDigit(int digit, glm::vec2 center, float height, glm::vec4 color)
+		{
+			// Segment bits: a (top), b (top right), c (bottom right), d (bottom), e (bottom left), f (top left), g (middle)
+			static const uint8_t segments[10] = { 0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F };
+
+			if (digit < 0 || digit > 9)
+				return;
+
+			float width = height * 0.5f;
+			float thickness = height * 0.12f;
+			float halfW = width * 0.5f;
+			float halfH = height * 0.5f;
+
+			glm::vec2 horizontal = { width, thickness };
+			glm::vec2 vertical = { thickness, halfH };
+
+			const glm::vec2 positions[7] = {
+				{ 0.0f, -halfH + thickness * 0.5f },
+				{ halfW - thickness * 0.5f, -halfH * 0.5f },
+				{ halfW - thickness * 0.5f, halfH * 0.5f },
+				{ 0.0f, halfH - thickness * 0.5f },
+				{ -halfW + thickness * 0.5f, halfH * 0.5f },
+				{ -halfW + thickness * 0.5f, -halfH * 0.5f },
+				{ 0.0f, 0.0f }
+			};
+
+			for (int segment = 0; segment < 7; segment++)
+			{
+				if (segments[digit] & (1 << segment))
+				{
+					bool isHorizontal = segment == 0 || segment == 3 || segment == 6;
+					submit(center + positions[segment], isHorizontal ? horizontal : vertical, color);
+				}
+			}
+		}
+
+		void BeQuadBatch::submitNumber(int value, glm::vec2 center, float height, glm::vec4 color)
+		{
+			std::string text = std::to_string(value < 0 ? 0 : value);
+
+			float advance = height * 0.7f;
+			float start = center.x - advance * (text.size() - 1) * 0.5f;
+
+			for (size_t i = 0; i < text.size(); i++)
+				submitDigit(text[i] - '0', { start + advance * i, center.y }, height, color);
+		}
+	}
+}
\ No newline at end of file
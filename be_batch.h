@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <array>
+
+namespace be
+{
+	namespace renderer {
+
+		// One quad of the 2D batch, read per instance by shader.vert. Positions and sizes are in normalized device coordinates.
+		struct QuadInstance {
+			glm::vec2 position;
+			glm::vec2 size;
+			glm::vec4 color;
+			glm::vec4 uvRect;
+
+			static VkVertexInputBindingDescription getBindingDescription()
+			{
+				VkVertexInputBindingDescription description = {};
+
+				description.binding = 1;
+				description.stride = sizeof(QuadInstance);
+				description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+				return description;
+			}
+
+			static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions()
+			{
+				std::array<VkVertexInputAttributeDescription, 4> descriptions = {};
+
+				descriptions[0].binding = 1;
+				descriptions[0].location = 2;
+				descriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+				descriptions[0].offset = offsetof(QuadInstance, position);
+
+				descriptions[1].binding = 1;
+				descriptions[1].location = 3;
+				descriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+				descriptions[1].offset = offsetof(QuadInstance, size);
+
+				descriptions[2].binding = 1;
+				descriptions[2].location = 4;
+				descriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+				descriptions[2].offset = offsetof(QuadInstance, color);
+
+				descriptions[3].binding = 1;
+				descriptions[3].location = 5;
+				descriptions[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+				descriptions[3].offset = offsetof(QuadInstance, uvRect);
+
+				return descriptions;
+			}
+		};
+
+		// CPU side list of quads for the current frame. The renderer copies it into the frame's instance buffer and
+		// draws all of it with a single instanced draw of the unit quad, or with one per range of instances when
+		// recording into secondary command buffers.
+		class BeQuadBatch
+		{
+		public:
+			void begin() { quads.clear(); }
+
+			void submit(const QuadInstance& quad) { quads.push_back(quad); }
+			void submit(glm::vec2 position, glm::vec2 size, glm::vec4 color, glm::vec4 uvRect = { 0.0f, 0.0f, 1.0f, 1.0f });
+
+			// Appends count uninitialized quads for bulk writers, the pointer is valid until the next submit
+			QuadInstance* allocate(size_t count);
+
+			// Seven segment digit of the given height, the digit is height / 2 wide
+			void submitDigit(int digit, glm::vec2 center, float height, glm::vec4 color);
+			void submitNumber(int value, glm::vec2 center, float height, glm::vec4 color);
+
+			// Exchanges contents with a batch built elsewhere, e.g. on the simulation thread, without copying
+			void swap(BeQuadBatch& other) { quads.swap(other.quads); }
+
+			size_t size() const { return quads.size(); }
+			bool empty() const { return quads.empty(); }
+			const QuadInstance* data() const { return quads.data(); }
+
+		private:
+			std::vector<QuadInstance> quads;
+		};
+	}
+}
\ No newline at end of file
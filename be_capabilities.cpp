@@ -0,0 +1,199 @@
+#include "be_capabilities.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace be {
+	namespace renderer {
+
+		static bool hasExtension(const std::vector<VkExtensionProperties>& available, const char* name)
+		{
+			for (const auto& extension : available)
+			{
+				if (strcmp(extension.extensionName, name) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		static std::vector<VkExtensionProperties> deviceExtensionProperties(VkPhysicalDevice device)
+		{
+			uint32_t extensionCount = 0;
+			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+			std::vector<VkExtensionProperties> extensions(extensionCount);
+			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+			return extensions;
+		}
+
+		void RendererCapabilities::dump(std::ostream& out) const
+		{
+			out << "capabilities: " << deviceName << ", Vulkan " << VK_API_VERSION_MAJOR(apiVersion) << "." << VK_API_VERSION_MINOR(apiVersion)
+				<< (presentation ? ", presentation" : ", headless")
+				<< (debugUtils ? ", debug utils" : "")
+				<< (timelineSemaphore ? ", timeline semaphore" : "")
+				<< (dynamicRendering ? ", dynamic rendering" : "")
+				<< (presentWait ? ", present wait" : "")
+				<< (memoryBudget ? ", memory budget" : "")
+				<< (pipelineStatistics ? ", pipeline statistics" : "") << std::endl;
+		}
+
+		std::vector<const char*> negotiateInstanceExtensions(const CapabilityRequest& request, RendererCapabilities& capabilities)
+		{
+			uint32_t extensionCount = 0;
+			if (vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr) != VK_SUCCESS)
+				throw std::runtime_error("Error enumerating extensions");
+
+			std::vector<VkExtensionProperties> available(extensionCount);
+			if (vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, available.data()) != VK_SUCCESS)
+				throw std::runtime_error("Error enumerating extensions");
+
+			// Names are the header's string literals, nothing to free
+			std::vector<const char*> extensions;
+			if (request.presentation)
+			{
+				extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#ifdef _WIN32
+				extensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+			}
+			if (request.debugUtils)
+				extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
+			for (const char* name : extensions)
+			{
+				if (!hasExtension(available, name))
+					throw std::runtime_error(std::string("Missing instance extension ") + name);
+			}
+
+			capabilities.presentation = request.presentation;
+			capabilities.debugUtils = request.debugUtils;
+			return extensions;
+		}
+
+		std::vector<const char*> requiredDeviceExtensions(const CapabilityRequest& request)
+		{
+			if (!request.presentation)
+				return {};
+
+			return { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		}
+
+		bool hasDeviceExtensions(VkPhysicalDevice device, const std::vector<const char*>& names)
+		{
+			auto available = deviceExtensionProperties(device);
+			for (const char* name : names)
+			{
+				if (!hasExtension(available, name))
+					return false;
+			}
+			return true;
+		}
+
+		void BeDeviceNegotiation::negotiate(VkPhysicalDevice physicalDevice, const CapabilityRequest& request, RendererCapabilities& capabilities)
+		{
+			auto available = deviceExtensionProperties(physicalDevice);
+			extensions = requiredDeviceExtensions(request);
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			capabilities.apiVersion = properties.apiVersion;
+			capabilities.deviceName = properties.deviceName;
+			uint32_t minorVersion = VK_API_VERSION_MAJOR(properties.apiVersion) > 1 ? UINT32_MAX : VK_API_VERSION_MINOR(properties.apiVersion);
+
+			// One query for every feature struct that may be enabled, each only chained when the device knows it
+			VkPhysicalDeviceVulkan12Features supported12 = {};
+			supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+			VkPhysicalDeviceVulkan13Features supported13 = {};
+			supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_13_FEATURES;
+			VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId = {};
+			supportedPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+			VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait = {};
+			supportedPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+			bool presentWaitExtensions = request.presentation && request.presentWait
+				&& hasExtension(available, VK_KHR_PRESENT_ID_EXTENSION_NAME) && hasExtension(available, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+			VkPhysicalDeviceFeatures2 supported = {};
+			supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			void** next = &supported.pNext;
+			if (minorVersion >= 2)
+			{
+				*next = &supported12;
+				next = &supported12.pNext;
+			}
+			if (minorVersion >= 3)
+			{
+				*next = &supported13;
+				next = &supported13.pNext;
+			}
+			if (presentWaitExtensions)
+			{
+				*next = &supportedPresentId;
+				supportedPresentId.pNext = &supportedPresentWait;
+			}
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+
+			// Core features
+			// Statistics recorded into secondary buffers are useless without inherited queries, both go or neither
+			bool statisticsQuery = request.pipelineStatistics && supported.features.pipelineStatisticsQuery == VK_TRUE;
+			bool inheritedQueries = request.pipelineStatistics && request.secondaryCommandBuffers && supported.features.inheritedQueries == VK_TRUE;
+			capabilities.pipelineStatistics = statisticsQuery && (!request.secondaryCommandBuffers || inheritedQueries);
+			capabilities.inheritedQueries = capabilities.pipelineStatistics && inheritedQueries;
+
+			features = {};
+			features.pipelineStatisticsQuery = capabilities.pipelineStatistics ? VK_TRUE : VK_FALSE;
+			features.inheritedQueries = capabilities.inheritedQueries ? VK_TRUE : VK_FALSE;
+
+			capabilities.timelineSemaphore = request.timelineSemaphore && supported12.timelineSemaphore == VK_TRUE;
+			capabilities.dynamicRendering = request.dynamicRendering && supported13.dynamicRendering == VK_TRUE && supported13.synchronization2 == VK_TRUE;
+			capabilities.presentWait = presentWaitExtensions && supportedPresentId.presentId == VK_TRUE && supportedPresentWait.presentWait == VK_TRUE;
+			capabilities.memoryBudget = request.memoryBudget && hasExtension(available, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+			// Only structs with something enabled go into the chain, with nothing but that enabled
+			featureChain = nullptr;
+			vulkan12Features = {};
+			vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+			vulkan13Features = {};
+			vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_13_FEATURES;
+			presentIdFeatures = {};
+			presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+			presentWaitFeatures = {};
+			presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+			if (capabilities.presentWait)
+			{
+				extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+				extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+				presentIdFeatures.presentId = VK_TRUE;
+				presentWaitFeatures.presentWait = VK_TRUE;
+				presentIdFeatures.pNext = &presentWaitFeatures;
+				featureChain = &presentIdFeatures;
+			}
+			if (capabilities.dynamicRendering)
+			{
+				vulkan13Features.dynamicRendering = VK_TRUE;
+				vulkan13Features.synchronization2 = VK_TRUE;
+				vulkan13Features.pNext = featureChain;
+				featureChain = &vulkan13Features;
+			}
+			if (capabilities.timelineSemaphore)
+			{
+				vulkan12Features.timelineSemaphore = VK_TRUE;
+				vulkan12Features.pNext = featureChain;
+				featureChain = &vulkan12Features;
+			}
+			if (capabilities.memoryBudget)
+				extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+
+		void BeDeviceNegotiation::apply(VkDeviceCreateInfo& createInfo) const
+		{
+			createInfo.pEnabledFeatures = &features;
+			createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+			createInfo.ppEnabledExtensionNames = extensions.data();
+			createInfo.pNext = featureChain;
+		}
+	}
+}
\ No newline at end of file
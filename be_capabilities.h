@@ -0,0 +1,87 @@
+#pragma once
+
+#ifdef _WIN32
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include <vulkan/vulkan.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace be
+{
+	namespace renderer {
+
+		// What the renderer would like to use. Required parts fail instance or device creation when missing, optional
+		// ones are only enabled where supported.
+		struct CapabilityRequest
+		{
+			// Surface and swapchain, required unless rendering headless
+			bool presentation = true;
+			// Required for the validation messenger
+			bool debugUtils = false;
+
+			// Optional
+			bool timelineSemaphore = true;
+			bool dynamicRendering = true;
+			bool presentWait = true;
+			bool memoryBudget = true;
+			bool pipelineStatistics = true;
+			// Statistics queries then have to stay active across vkCmdExecuteCommands
+			bool secondaryCommandBuffers = false;
+		};
+
+		// What the instance and device were actually created with. The renderer branches on this instead of asking
+		// Vulkan again.
+		struct RendererCapabilities
+		{
+			uint32_t apiVersion = 0;
+			::std::string deviceName;
+			bool presentation = false;
+			bool debugUtils = false;
+
+			bool timelineSemaphore = false;
+			// Together with synchronization2
+			bool dynamicRendering = false;
+			// VK_KHR_present_id and VK_KHR_present_wait
+			bool presentWait = false;
+			bool memoryBudget = false;
+			bool pipelineStatistics = false;
+			bool inheritedQueries = false;
+
+			void dump(::std::ostream& out) const;
+		};
+
+		// Only the instance extensions request needs, throws when one of them is missing
+		::std::vector<const char*> negotiateInstanceExtensions(const CapabilityRequest& request, RendererCapabilities& capabilities);
+
+		// Device extensions the renderer can't run without
+		::std::vector<const char*> requiredDeviceExtensions(const CapabilityRequest& request);
+		bool hasDeviceExtensions(VkPhysicalDevice device, const ::std::vector<const char*>& names);
+
+		// Extensions and feature structs for vkCreateDevice. The feature chain points into the object itself, so it
+		// can't be copied and has to outlive the vkCreateDevice call.
+		class BeDeviceNegotiation
+		{
+		public:
+			BeDeviceNegotiation() = default;
+			BeDeviceNegotiation(const BeDeviceNegotiation&) = delete;
+			BeDeviceNegotiation& operator=(const BeDeviceNegotiation&) = delete;
+
+			// Picks what physicalDevice supports of request and records it in capabilities
+			void negotiate(VkPhysicalDevice physicalDevice, const CapabilityRequest& request, RendererCapabilities& capabilities);
+			// Sets the extensions, features and feature chain of createInfo
+			void apply(VkDeviceCreateInfo& createInfo) const;
+
+		private:
+			::std::vector<const char*> extensions;
+			VkPhysicalDeviceFeatures features = {};
+			VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+			VkPhysicalDeviceVulkan13Features vulkan13Features = {};
+			VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+			VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+			void* featureChain = nullptr;
+		};
+	}
+}
\ No newline at end of file
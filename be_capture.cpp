@@ -0,0 +1,232 @@
+#include "be_capture.h"
+#include "be_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace be {
+	namespace renderer {
+
+		static bool isBgra(VkFormat format)
+		{
+			return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+		}
+
+		BeFrameCapture::FrameSink BeFrameCapture::fileSink(const std::string& directory, CaptureFormat format)
+		{
+			std::error_code error;
+			std::filesystem::create_directories(directory, error);
+			if (error)
+				throw std::runtime_error("Failed to create capture directory " + directory + ": " + error.message());
+
+			return [directory, format](const CapturedFrame& frame) {
+				std::string number = std::to_string(frame.frame);
+				std::string name = directory + "/frame_" + std::string(number.size() < 6 ? 6 - number.size() : 0, '0') + number;
+
+				if (format == CaptureFormat::Png)
+				{
+					writePng(name + ".png", toRgba(frame));
+					return;
+				}
+
+				name += "_" + std::to_string(frame.extent.width) + "x" + std::to_string(frame.extent.height) + (isBgra(frame.format) ? ".bgra" : ".rgba");
+				std::ofstream file(name, std::ios::binary | std::ios::trunc);
+				if (!file.write(reinterpret_cast<const char*>(frame.pixels.data()), frame.pixels.size()))
+					throw std::runtime_error("Failed to write " + name);
+			};
+		}
+
+		RgbaImage BeFrameCapture::toRgba(const CapturedFrame& frame)
+		{
+			RgbaImage image;
+			image.width = frame.extent.width;
+			image.height = frame.extent.height;
+			image.pixels = frame.pixels;
+
+			if (isBgra(frame.format))
+			{
+				for (size_t i = 0; i < image.pixels.size(); i += 4)
+					std::swap(image.pixels[i], image.pixels[i + 2]);
+			}
+			return image;
+		}
+
+		void BeFrameCapture::init(VkDevice device, BeAllocator* allocator, FrameSink sink, bool lossless)
+		{
+			this->device = device;
+			this->allocator = allocator;
+			this->sink = sink;
+			this->lossless = lossless;
+
+			frames = std::vector<CapturedFrame>(QUEUED_FRAMES);
+			freeFrames.reset(frames.size());
+			readyFrames.reset(frames.size());
+			for (auto& frame : frames)
+				freeFrames.push(&frame);
+
+			writer = std::thread([this] { writerLoop(); });
+		}
+
+		void BeFrameCapture::destroy()
+		{
+			if (writer.joinable())
+			{
+				readyFrames.close();
+				writer.join();
+			}
+			freeFrames.close();
+
+			for (auto* list : { &slots, &retired })
+			{
+				for (auto& readback : *list)
+					allocator->destroyBuffer(readback.buffer, readback.allocation);
+				list->clear();
+			}
+		}
+
+		void BeFrameCapture::resize(uint32_t slotCount, VkExtent2D extent, VkFormat imageFormat)
+		{
+			if (imageFormat != VK_FORMAT_R8G8B8A8_UNORM && imageFormat != VK_FORMAT_R8G8B8A8_SRGB && !isBgra(imageFormat))
+				throw std::runtime_error("Capture needs an 8 bit RGBA or BGRA image format");
+
+			for (auto& readback : slots)
+			{
+				if (readback.frame != 0)
+					retired.push_back(readback);
+				else
+					allocator->destroyBuffer(readback.buffer, readback.allocation);
+			}
+			slots.assign(slotCount, {});
+
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+			bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			for (auto& readback : slots)
+			{
+				readback.extent = extent;
+				readback.format = imageFormat;
+
+				if (vkCreateBuffer(device, &bufferInfo, nullptr, &readback.buffer) != VK_SUCCESS)
+					throw std::runtime_error("Failed to create capture buffer");
+
+				VkMemoryRequirements requirements;
+				vkGetBufferMemoryRequirements(device, readback.buffer, &requirements);
+
+				// Cached memory makes reading the pixels back fast, not every device offers it for buffers
+				VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+				try
+				{
+					allocator->findMemoryType(requirements.memoryTypeBits, properties);
+				}
+				catch (const std::runtime_error&)
+				{
+					properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+				}
+
+				readback.allocation = allocator->allocate(requirements, properties);
+				vkBindBufferMemory(device, readback.buffer, readback.allocation.memory, readback.allocation.offset);
+			}
+		}
+
+		void BeFrameCapture::cmdCopy(VkCommandBuffer commandBuffer, VkImage image, uint32_t slot) const
+		{
+			const Readback& readback = slots[slot];
+
+			VkBufferImageCopy region = {};
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = { readback.extent.width, readback.extent.height, 1 };
+			vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+
+			// The frame's fence or timeline value only makes the copy visible to the host together with this
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = readback.buffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		}
+
+		void BeFrameCapture::submitted(uint32_t slot, uint64_t frame)
+		{
+			slots[slot].frame = frame;
+		}
+
+		void BeFrameCapture::collect(uint64_t completedFrame)
+		{
+			for (auto* list : { &retired, &slots })
+			{
+				for (auto& readback : *list)
+				{
+					if (readback.frame != 0 && readback.frame <= completedFrame)
+						read(readback);
+				}
+			}
+
+			for (size_t i = 0; i < retired.size();)
+			{
+				if (retired[i].frame == 0)
+				{
+					allocator->destroyBuffer(retired[i].buffer, retired[i].allocation);
+					retired[i] = retired.back();
+					retired.pop_back();
+				}
+				else
+					i++;
+			}
+		}
+
+		void BeFrameCapture::read(Readback& readback)
+		{
+			uint64_t frame = readback.frame;
+			readback.frame = 0;
+
+			// The writer hands every frame back once the sink is done with it, a lossless capture waits for that
+			CapturedFrame* captured = nullptr;
+			if (lossless ? !freeFrames.pop(captured) : !freeFrames.tryPop(captured))
+			{
+				droppedFrames++;
+				return;
+			}
+
+			allocator->invalidate(readback.allocation);
+			const uint8_t* pixels = static_cast<const uint8_t*>(readback.allocation.mapped);
+			captured->frame = frame;
+			captured->extent = readback.extent;
+			captured->format = readback.format;
+			captured->pixels.assign(pixels, pixels + static_cast<size_t>(readback.extent.width) * readback.extent.height * 4);
+
+			readyFrames.push(captured);
+			capturedFrames++;
+		}
+
+		void BeFrameCapture::writerLoop()
+		{
+			CapturedFrame* frame = nullptr;
+			while (readyFrames.pop(frame))
+			{
+				try
+				{
+					sink(*frame);
+					writtenFrames++;
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << "capture: " << e.what() << std::endl;
+				}
+				freeFrames.push(frame);
+			}
+		}
+	}
+}
\ No newline at end of file
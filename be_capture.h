@@ -0,0 +1,110 @@
+#pragma once
+
+#include "be_allocator.h"
+#include "be_queue.h"
+#include "be_image.h"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace be
+{
+	namespace renderer {
+
+		enum class CaptureFormat
+		{
+			// The pixels as copied out of the image, in its channel order
+			Raw,
+			// 8 bit RGBA, see writePng
+			Png
+		};
+
+		// Copies rendered frames into a ring of host visible buffers, one per frame in flight, and hands them to a sink
+		// on a writer thread. The render thread only copies finished frames out of the ring: when the writer falls
+		// behind frames are dropped, never waited for, unless the capture is lossless.
+		class BeFrameCapture
+		{
+		public:
+			// Frames copied out of the ring and waiting for the writer
+			static constexpr uint32_t QUEUED_FRAMES = 8;
+
+			struct CapturedFrame
+			{
+				uint64_t frame = 0;
+				VkExtent2D extent = {};
+				VkFormat format = VK_FORMAT_UNDEFINED;
+				::std::vector<uint8_t> pixels;
+			};
+
+			// Runs on the writer thread, one frame at a time
+			using FrameSink = ::std::function<void(const CapturedFrame& frame)>;
+
+			// Writes every frame into its own file in directory, which is created if needed
+			static FrameSink fileSink(const ::std::string& directory, CaptureFormat format);
+			static RgbaImage toRgba(const CapturedFrame& frame);
+
+			BeFrameCapture() = default;
+			BeFrameCapture(const BeFrameCapture&) = delete;
+			BeFrameCapture& operator=(const BeFrameCapture&) = delete;
+
+			// Lossless captures make collect wait for the writer instead of dropping frames, for tests that need every frame
+			void init(VkDevice device, BeAllocator* allocator, FrameSink sink, bool lossless = false);
+			// Writes out what was already handed to the writer, frames still in the ring are lost
+			void destroy();
+
+			// One readback buffer per slot for images of extent and format. Buffers with a frame still in flight are
+			// read by collect before they go.
+			void resize(uint32_t slots, VkExtent2D extent, VkFormat format);
+
+			// Copies image, in TRANSFER_SRC_OPTIMAL, into the slot's buffer and makes it readable by the host
+			void cmdCopy(VkCommandBuffer commandBuffer, VkImage image, uint32_t slot) const;
+			// The frame number whose completion fills the slot's buffer
+			void submitted(uint32_t slot, uint64_t frame);
+			// Hands every buffered frame up to completedFrame to the writer. Never waits on the GPU, and only waits on the
+			// writer when lossless.
+			void collect(uint64_t completedFrame);
+
+			uint64_t getCapturedFrames() const { return capturedFrames; }
+			uint64_t getDroppedFrames() const { return droppedFrames; }
+			uint64_t getWrittenFrames() const { return writtenFrames.load(); }
+
+		private:
+			struct Readback
+			{
+				VkBuffer buffer = VK_NULL_HANDLE;
+				Allocation allocation;
+				VkExtent2D extent = {};
+				VkFormat format = VK_FORMAT_UNDEFINED;
+				// 0 while nothing is in flight
+				uint64_t frame = 0;
+			};
+
+			void read(Readback& readback);
+			void writerLoop();
+
+			VkDevice device = VK_NULL_HANDLE;
+			BeAllocator* allocator = nullptr;
+			FrameSink sink;
+			bool lossless = false;
+
+			::std::vector<Readback> slots;
+			// Replaced by a resize while their frame was in flight
+			::std::vector<Readback> retired;
+
+			::std::vector<CapturedFrame> frames;
+			BeBoundedQueue<CapturedFrame*> freeFrames;
+			BeBoundedQueue<CapturedFrame*> readyFrames;
+			::std::thread writer;
+
+			uint64_t capturedFrames = 0;
+			uint64_t droppedFrames = 0;
+			::std::atomic<uint64_t> writtenFrames{ 0 };
+		};
+	}
+}
\ No newline at end of file
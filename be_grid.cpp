@@ -0,0 +1,171 @@
+#include "be_grid.h"
+
+#include <algorithm>
+
+namespace be {
+
+	using namespace pong;
+
+	static const uint32_t CELL_COUNT = BeSpatialGrid::CELLS_PER_SIDE * BeSpatialGrid::CELLS_PER_SIDE;
+
+	static uint32_t cellCoordinate(Fixed value)
+	{
+		int32_t cell = (value + FIXED_ONE) / BeSpatialGrid::CELL_SIZE;
+		return static_cast<uint32_t>(std::min<int32_t>(std::max<int32_t>(cell, 0), BeSpatialGrid::CELLS_PER_SIDE - 1));
+	}
+
+	// Balls per range below which splitting the build isn't worth a job
+	static const size_t MIN_RANGE = 1024;
+
+	// One range per job thread, capped so every range has some work
+	static uint32_t rangeCountFor(size_t count, BeJobSystem* jobs)
+	{
+		uint32_t threads = jobs != nullptr ? jobs->getThreadCount() : 1;
+		return std::max(1u, std::min<uint32_t>(threads, static_cast<uint32_t>(count / MIN_RANGE + 1)));
+	}
+
+	// Runs fn(range, first, end) for every range of count items split into rangeCount contiguous ranges
+	template <typename Fn>
+	static void forEachRange(BeJobSystem* jobs, size_t count, uint32_t rangeCount, const Fn& fn)
+	{
+		auto runRanges = [&](uint32_t begin, uint32_t end) {
+			for (uint32_t range = begin; range < end; range++)
+				fn(range, count * range / rangeCount, count * (range + 1) / rangeCount);
+		};
+
+		if (jobs != nullptr)
+			jobs->parallelFor(rangeCount, 1, runRanges);
+		else
+			runRanges(0, rangeCount);
+	}
+
+	bool ballsOverlap(Fixed ax, Fixed ay, Fixed bx, Fixed by)
+	{
+		Fixed dx = ax - bx;
+		Fixed dy = ay - by;
+		return dx < 2 * BALL_HALF_WIDTH && dx > -2 * BALL_HALF_WIDTH && dy < 2 * BALL_HALF_HEIGHT && dy > -2 * BALL_HALF_HEIGHT;
+	}
+
+	void BeSpatialGrid::build(const Fixed* x, const Fixed* y, size_t count, BeJobSystem* jobs)
+	{
+		uint32_t rangeCount = rangeCountFor(count, jobs);
+
+		cellOf.resize(count);
+		sorted.resize(count);
+		cellStart.assign(CELL_COUNT + 1, 0);
+		rangeCounts.resize(rangeCount);
+
+		// Pass 1: cell key and histogram per range
+		forEachRange(jobs, count, rangeCount, [&](uint32_t range, size_t first, size_t end) {
+			auto& counts = rangeCounts[range];
+			counts.assign(CELL_COUNT, 0);
+			for (size_t i = first; i < end; i++)
+			{
+				uint32_t cell = cellCoordinate(y[i]) * CELLS_PER_SIDE + cellCoordinate(x[i]);
+				cellOf[i] = cell;
+				counts[cell]++;
+			}
+		});
+
+		// Pass 2: exclusive prefix sum in (cell, range) order, which turns every histogram entry into the write
+		// cursor of that range's slice of the cell
+		uint32_t offset = 0;
+		for (uint32_t cell = 0; cell < CELL_COUNT; cell++)
+		{
+			cellStart[cell] = offset;
+			for (auto& counts : rangeCounts)
+			{
+				uint32_t cellCount = counts[cell];
+				counts[cell] = offset;
+				offset += cellCount;
+			}
+		}
+		cellStart[CELL_COUNT] = offset;
+
+		// Pass 3: scatter, stable within each range so the result matches a single threaded sort
+		forEachRange(jobs, count, rangeCount, [&](uint32_t range, size_t first, size_t end) {
+			auto& cursors = rangeCounts[range];
+			for (size_t i = first; i < end; i++)
+				sorted[cursors[cellOf[i]]++] = static_cast<uint32_t>(i);
+		});
+	}
+
+	void BeSpatialGrid::findPairs(const Fixed* x, const Fixed* y, std::vector<BallPair>& pairs, BeJobSystem* jobs) const
+	{
+		uint32_t rangeCount = rangeCountFor(sorted.size(), jobs);
+		if (rangeCount == 1)
+		{
+			findPairsInRows(x, y, 0, CELLS_PER_SIDE, pairs);
+			return;
+		}
+
+		// Each job collects a band of rows, the bands are appended in row order
+		bands.resize(rangeCount);
+		forEachRange(jobs, CELLS_PER_SIDE, rangeCount, [&](uint32_t range, size_t first, size_t end) {
+			bands[range].clear();
+			findPairsInRows(x, y, static_cast<uint32_t>(first), static_cast<uint32_t>(end), bands[range]);
+		});
+
+		for (const auto& band : bands)
+			pairs.insert(pairs.end(), band.begin(), band.end());
+	}
+
+	void BeSpatialGrid::findPairsInRows(const Fixed* x, const Fixed* y, uint32_t firstRow, uint32_t lastRow, std::vector<BallPair>& pairs) const
+	{
+		// Only the cell itself and the forward half of its neighbours, so every pair is tested once
+		const int32_t neighbours[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+		for (uint32_t row = firstRow; row < lastRow; row++)
+		{
+			for (uint32_t column = 0; column < CELLS_PER_SIDE; column++)
+			{
+				uint32_t cell = row * CELLS_PER_SIDE + column;
+				uint32_t begin = cellStart[cell];
+				uint32_t end = cellStart[cell + 1];
+
+				for (uint32_t i = begin; i < end; i++)
+				{
+					uint32_t a = sorted[i];
+					for (uint32_t j = i + 1; j < end; j++)
+					{
+						uint32_t b = sorted[j];
+						if (ballsOverlap(x[a], y[a], x[b], y[b]))
+							pairs.push_back({ a, b });
+					}
+				}
+
+				for (const auto& offset : neighbours)
+				{
+					int32_t neighbourColumn = static_cast<int32_t>(column) + offset[0];
+					uint32_t neighbourRow = row + offset[1];
+					if (neighbourColumn < 0 || neighbourColumn >= static_cast<int32_t>(CELLS_PER_SIDE) || neighbourRow >= CELLS_PER_SIDE)
+						continue;
+
+					uint32_t other = neighbourRow * CELLS_PER_SIDE + static_cast<uint32_t>(neighbourColumn);
+					for (uint32_t i = begin; i < end; i++)
+					{
+						uint32_t a = sorted[i];
+						for (uint32_t j = cellStart[other]; j < cellStart[other + 1]; j++)
+						{
+							uint32_t b = sorted[j];
+							if (ballsOverlap(x[a], y[a], x[b], y[b]))
+								pairs.push_back({ a, b });
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void findPairsBruteForce(const Fixed* x, const Fixed* y, size_t count, std::vector<BallPair>& pairs)
+	{
+		for (size_t a = 0; a < count; a++)
+		{
+			for (size_t b = a + 1; b < count; b++)
+			{
+				if (ballsOverlap(x[a], y[a], x[b], y[b]))
+					pairs.push_back({ static_cast<uint32_t>(a), static_cast<uint32_t>(b) });
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "be_pong.h"
+#include "be_jobs.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace be
+{
+	struct BallPair
+	{
+		uint32_t a;
+		uint32_t b;
+	};
+
+	// Uniform grid broadphase over the playing field. Balls are counting sorted by cell, so every cell is a
+	// contiguous range of the sorted index array and cellStart holds the prefix sums of the cell sizes. The cells
+	// are as large as a ball, so overlapping balls are always in the same or a neighbouring cell.
+	class BeSpatialGrid
+	{
+	public:
+		// Cell edge in field units, at least one ball wide and one ball high
+		static constexpr Fixed CELL_SIZE = 2 * (pong::BALL_HALF_HEIGHT > pong::BALL_HALF_WIDTH ? pong::BALL_HALF_HEIGHT : pong::BALL_HALF_WIDTH);
+		static constexpr uint32_t CELLS_PER_SIDE = (2 * FIXED_ONE + CELL_SIZE - 1) / CELL_SIZE;
+
+		// Rebuilds the grid from the given positions. Building on the job system gives the same result, each job sorts
+		// a contiguous range of balls into its own slice of every cell.
+		void build(const Fixed* x, const Fixed* y, size_t count, BeJobSystem* jobs = nullptr);
+
+		// Appends every overlapping pair, ordered by cell and then by position within the cell, so the order only
+		// depends on the positions and not on the thread count
+		void findPairs(const Fixed* x, const Fixed* y, ::std::vector<BallPair>& pairs, BeJobSystem* jobs = nullptr) const;
+
+		const uint32_t* sortedBalls() const { return sorted.data(); }
+		const uint32_t* cellStarts() const { return cellStart.data(); }
+
+	private:
+		void findPairsInRows(const Fixed* x, const Fixed* y, uint32_t firstRow, uint32_t lastRow, ::std::vector<BallPair>& pairs) const;
+
+		::std::vector<uint32_t> cellOf;
+		::std::vector<uint32_t> cellStart;
+		::std::vector<uint32_t> sorted;
+		// Per range histograms and write cursors, CELLS_PER_SIDE squared entries each
+		::std::vector<::std::vector<uint32_t>> rangeCounts;
+		mutable ::std::vector<::std::vector<BallPair>> bands;
+	};
+
+	// Reference O(n^2) search, pairs come out ordered by (a, b)
+	void findPairsBruteForce(const Fixed* x, const Fixed* y, size_t count, ::std::vector<BallPair>& pairs);
+	bool ballsOverlap(Fixed ax, Fixed ay, Fixed bx, Fixed by);
+}
\ No newline at end of file
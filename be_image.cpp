@@ -0,0 +1,217 @@
+#include "be_image.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace be {
+
+	static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc)
+	{
+		static const auto table = [] {
+			std::vector<uint32_t> entries(256);
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; bit++)
+					value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+				entries[i] = value;
+			}
+			return entries;
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	static uint32_t adler32(const std::vector<uint8_t>& data)
+	{
+		uint32_t a = 1, b = 0;
+		for (uint8_t byte : data)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	static void putBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (int shift = 24; shift >= 0; shift -= 8)
+			out.push_back(static_cast<uint8_t>(value >> shift));
+	}
+
+	static uint32_t getBigEndian(const uint8_t* data)
+	{
+		return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+	}
+
+	static void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> header;
+		putBigEndian(header, static_cast<uint32_t>(data.size()));
+		header.insert(header.end(), type, type + 4);
+
+		std::vector<uint8_t> trailer;
+		putBigEndian(trailer, crc32(data.data(), data.size(), crc32(header.data() + 4, 4, 0)));
+
+		file.write(reinterpret_cast<const char*>(header.data()), header.size());
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		file.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+	}
+
+	void writePng(const std::string& path, const RgbaImage& image)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			throw std::runtime_error("Failed to write " + path);
+
+		file.write(reinterpret_cast<const char*>(PNG_SIGNATURE), sizeof(PNG_SIGNATURE));
+
+		std::vector<uint8_t> header;
+		putBigEndian(header, image.width);
+		putBigEndian(header, image.height);
+		// 8 bits per channel, RGBA, deflate, adaptive filtering, no interlace
+		header.insert(header.end(), { 8, 6, 0, 0, 0 });
+		writeChunk(file, "IHDR", header);
+
+		// Every row with filter type 0, packed into stored deflate blocks of at most 65535 bytes
+		size_t rowSize = static_cast<size_t>(image.width) * 4;
+		std::vector<uint8_t> raw;
+		raw.reserve((rowSize + 1) * image.height);
+		for (uint32_t y = 0; y < image.height; y++)
+		{
+			raw.push_back(0);
+			raw.insert(raw.end(), image.pixels.begin() + y * rowSize, image.pixels.begin() + (y + 1) * rowSize);
+		}
+
+		std::vector<uint8_t> data = { 0x78, 0x01 };
+		data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+		for (size_t offset = 0; offset < raw.size();)
+		{
+			size_t size = std::min<size_t>(65535, raw.size() - offset);
+			data.push_back(offset + size == raw.size() ? 1 : 0);
+			data.push_back(static_cast<uint8_t>(size));
+			data.push_back(static_cast<uint8_t>(size >> 8));
+			data.push_back(static_cast<uint8_t>(~size));
+			data.push_back(static_cast<uint8_t>(~size >> 8));
+			data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + size);
+			offset += size;
+		}
+		putBigEndian(data, adler32(raw));
+		writeChunk(file, "IDAT", data);
+
+		writeChunk(file, "IEND", {});
+
+		if (!file)
+			throw std::runtime_error("Failed to write " + path);
+	}
+
+	RgbaImage readPng(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("Failed to open " + path);
+		std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		auto fail = [&path](const char* reason) { return std::runtime_error(path + ": " + reason); };
+
+		if (bytes.size() < sizeof(PNG_SIGNATURE) || memcmp(bytes.data(), PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0)
+			throw fail("not a PNG file");
+
+		RgbaImage image;
+		std::vector<uint8_t> data;
+		for (size_t offset = sizeof(PNG_SIGNATURE); offset + 12 <= bytes.size();)
+		{
+			uint32_t size = getBigEndian(&bytes[offset]);
+			if (offset + 12 + size > bytes.size())
+				throw fail("truncated chunk");
+
+			const uint8_t* type = &bytes[offset + 4];
+			const uint8_t* body = &bytes[offset + 8];
+			if (crc32(body, size, crc32(type, 4, 0)) != getBigEndian(body + size))
+				throw fail("chunk checksum mismatch");
+
+			if (memcmp(type, "IHDR", 4) == 0)
+			{
+				if (size != 13 || body[8] != 8 || body[9] != 6 || body[12] != 0)
+					throw fail("only 8 bit RGBA without interlacing is supported");
+				image.width = getBigEndian(body);
+				image.height = getBigEndian(body + 4);
+			}
+			else if (memcmp(type, "IDAT", 4) == 0)
+				data.insert(data.end(), body, body + size);
+			else if (memcmp(type, "IEND", 4) == 0)
+				break;
+
+			offset += 12 + size;
+		}
+
+		// Stored deflate blocks only, with every row unfiltered
+		std::vector<uint8_t> raw;
+		size_t offset = 2;
+		bool last = data.size() < 2;
+		while (!last)
+		{
+			if (offset + 5 > data.size())
+				throw fail("truncated image data");
+			if ((data[offset] & 0x06) != 0)
+				throw fail("compressed image data, expected an image written by writePng");
+
+			last = (data[offset] & 1) != 0;
+			size_t size = data[offset + 1] | (data[offset + 2] << 8);
+			offset += 5;
+			if (offset + size > data.size())
+				throw fail("truncated image data");
+
+			raw.insert(raw.end(), data.begin() + offset, data.begin() + offset + size);
+			offset += size;
+		}
+
+		size_t rowSize = static_cast<size_t>(image.width) * 4;
+		if (image.width == 0 || raw.size() != (rowSize + 1) * image.height)
+			throw fail("image data doesn't match its size");
+
+		image.pixels.resize(rowSize * image.height);
+		for (uint32_t y = 0; y < image.height; y++)
+		{
+			const uint8_t* row = &raw[y * (rowSize + 1)];
+			if (row[0] != 0)
+				throw fail("filtered rows, expected an image written by writePng");
+			memcpy(&image.pixels[y * rowSize], row + 1, rowSize);
+		}
+
+		return image;
+	}
+
+	ImageDifference compareImages(const RgbaImage& a, const RgbaImage& b, uint32_t tolerance)
+	{
+		ImageDifference difference;
+		if (a.width != b.width || a.height != b.height)
+		{
+			difference.mismatchedPixels = static_cast<uint64_t>(std::max(a.width, b.width)) * std::max(a.height, b.height);
+			difference.maxChannelDifference = 255;
+			return difference;
+		}
+
+		for (size_t i = 0; i < a.pixels.size(); i += 4)
+		{
+			uint32_t pixelDifference = 0;
+			for (size_t c = 0; c < 4; c++)
+				pixelDifference = std::max<uint32_t>(pixelDifference, std::abs(a.pixels[i + c] - b.pixels[i + c]));
+
+			difference.maxChannelDifference = std::max(difference.maxChannelDifference, pixelDifference);
+			if (pixelDifference > tolerance)
+				difference.mismatchedPixels++;
+		}
+
+		return difference;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace be
+{
+	// 8 bit RGBA pixels, rows top to bottom without padding
+	struct RgbaImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		::std::vector<uint8_t> pixels;
+	};
+
+	// Uncompressed deflate: fast enough to keep up with capture, and readable by readPng without an inflater
+	void writePng(const ::std::string& path, const RgbaImage& image);
+	// Only reads what writePng writes, throws for anything else
+	RgbaImage readPng(const ::std::string& path);
+
+	struct ImageDifference
+	{
+		// Pixels with any channel further apart than the tolerance
+		uint64_t mismatchedPixels = 0;
+		uint32_t maxChannelDifference = 0;
+	};
+
+	// Images of different sizes differ in every pixel
+	ImageDifference compareImages(const RgbaImage& a, const RgbaImage& b, uint32_t tolerance);
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "be_jobs.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace be {
+
+	static constexpr uint32_t JOB_RING_SIZE = 2 * BeJobSystem::QUEUE_CAPACITY;
+	// Failed steal rounds before an idle worker goes to sleep
+	static constexpr uint32_t IDLE_SPINS = 64;
+
+	static thread_local const BeJobSystem* t_jobSystem = nullptr;
+	static thread_local uint32_t t_jobThread = 0;
+
+	bool BeJobSystem::Deque::push(Job* job)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= static_cast<int64_t>(QUEUE_CAPACITY))
+			return false;
+
+		// The release store publishes the job's fields to thieves that acquire bottom
+		slots[b & (QUEUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_release);
+		return true;
+	}
+
+	BeJobSystem::Job* BeJobSystem::Deque::pop()
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = slots[b & (QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			// Last job, race the thieves for it
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	BeJobSystem::Job* BeJobSystem::Deque::steal()
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return nullptr;
+
+		Job* job = slots[t & (QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return job;
+	}
+
+	void BeJobSystem::init(uint32_t threadCount, uint32_t extraThreads)
+	{
+		if (!workers.empty())
+			throw std::runtime_error("job system is already running");
+
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		this->threadCount = threadCount;
+		attachedThreads = 0;
+		ownerThread = std::this_thread::get_id();
+		stopping = false;
+		queuedJobs = 0;
+		sleepingWorkers = 0;
+		stolenJobs = 0;
+
+		for (uint32_t i = 0; i < threadCount + extraThreads; i++)
+		{
+			auto worker = std::make_unique<Worker>();
+			worker->jobs = std::vector<Job>(JOB_RING_SIZE);
+			worker->random = 0x9E3779B9u * (i + 1);
+			workers.push_back(std::move(worker));
+		}
+
+		for (uint32_t i = 1; i < threadCount; i++)
+			workers[i]->thread = std::thread(&BeJobSystem::workerLoop, this, i);
+	}
+
+	void BeJobSystem::destroy()
+	{
+		if (workers.empty())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+
+		for (auto& worker : workers)
+		{
+			if (worker->thread.joinable())
+				worker->thread.join();
+		}
+		workers.clear();
+		threadCount = 0;
+	}
+
+	void BeJobSystem::attachThread()
+	{
+		uint32_t index = threadCount + attachedThreads.fetch_add(1);
+		if (index >= workers.size())
+			throw std::runtime_error("no free job system slot to attach a thread to");
+
+		t_jobSystem = this;
+		t_jobThread = index;
+	}
+
+	uint32_t BeJobSystem::currentThread() const
+	{
+		if (t_jobSystem == this)
+			return t_jobThread;
+		if (std::this_thread::get_id() == ownerThread)
+			return 0;
+		throw std::runtime_error("jobs can only be submitted from the job system's own threads");
+	}
+
+	void BeJobSystem::run(BeJobCounter& counter, JobFn fn, void* data, uint32_t begin, uint32_t end)
+	{
+		uint32_t thread = currentThread();
+		Worker& worker = *workers[thread];
+
+		counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+		// The slot's last job may still be queued or running on a thief, then this one runs inline from the stack
+		Job* job = &worker.jobs[worker.nextJob & (JOB_RING_SIZE - 1)];
+		if (job->busy.load(std::memory_order_acquire))
+		{
+			runInline(fn, data, begin, end, counter);
+			return;
+		}
+
+		job->fn = fn;
+		job->data = data;
+		job->begin = begin;
+		job->end = end;
+		job->counter = &counter;
+		job->busy.store(true, std::memory_order_relaxed);
+
+		// Counted before the push, so the count never drops below the number of queued jobs
+		queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+		if (!worker.deque.push(job))
+		{
+			queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			job->busy.store(false, std::memory_order_relaxed);
+			runInline(fn, data, begin, end, counter);
+			return;
+		}
+		worker.nextJob++;
+
+		if (sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			wake.notify_one();
+		}
+	}
+
+	void BeJobSystem::wait(BeJobCounter& counter)
+	{
+		uint32_t thread = currentThread();
+
+		while (!counter.done())
+		{
+			if (Job* job = findJob(thread))
+				execute(job);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	BeJobSystem::Job* BeJobSystem::findJob(uint32_t thread)
+	{
+		Worker& worker = *workers[thread];
+		if (Job* job = worker.deque.pop())
+		{
+			queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+
+		// Start at a random victim so thieves don't all hammer the same deque
+		uint32_t count = static_cast<uint32_t>(workers.size());
+		worker.random ^= worker.random << 13;
+		worker.random ^= worker.random >> 17;
+		worker.random ^= worker.random << 5;
+		uint32_t first = worker.random % count;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t victim = (first + i) % count;
+			if (victim == thread)
+				continue;
+
+			if (Job* job = workers[victim]->deque.steal())
+			{
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				stolenJobs.fetch_add(1, std::memory_order_relaxed);
+				return job;
+			}
+		}
+		return nullptr;
+	}
+
+	void BeJobSystem::runInline(JobFn fn, void* data, uint32_t begin, uint32_t end, BeJobCounter& counter)
+	{
+		fn(data, begin, end);
+		counter.pending.fetch_sub(1, std::memory_order_release);
+	}
+
+	void BeJobSystem::execute(Job* job)
+	{
+		// Copied out first, the slot is handed back to its owner before the counter drops
+		JobFn fn = job->fn;
+		void* data = job->data;
+		uint32_t begin = job->begin;
+		uint32_t end = job->end;
+		BeJobCounter* counter = job->counter;
+		job->busy.store(false, std::memory_order_release);
+
+		runInline(fn, data, begin, end, *counter);
+	}
+
+	void BeJobSystem::workerLoop(uint32_t index)
+	{
+		t_jobSystem = this;
+		t_jobThread = index;
+
+		uint32_t idle = 0;
+		while (!stopping.load(std::memory_order_relaxed))
+		{
+			if (Job* job = findJob(index))
+			{
+				execute(job);
+				idle = 0;
+				continue;
+			}
+
+			if (++idle < IDLE_SPINS)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// Slow path, nothing to steal for a while
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+			wake.wait(lock, [this] { return stopping.load() || queuedJobs.load(std::memory_order_seq_cst) > 0; });
+			sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+			idle = 0;
+		}
+
+		t_jobSystem = nullptr;
+	}
+}
\ No newline at end of file
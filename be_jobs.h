@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace be
+{
+	// Number of jobs of a fork-join group still queued or running. A job may add children to the counter it runs
+	// under before it returns, wait() then waits for those as well.
+	class BeJobCounter
+	{
+	public:
+		bool done() const { return pending.load(::std::memory_order_acquire) == 0; }
+
+	private:
+		friend class BeJobSystem;
+		::std::atomic<uint32_t> pending{ 0 };
+	};
+
+	// Fixed set of threads with one work stealing deque each. The thread that calls init() counts as thread 0 and
+	// runs jobs while it waits, other threads of the app can get a deque of their own with attachThread(). Pushing,
+	// popping and stealing are lock free, the mutex is only taken to put idle workers to sleep and to wake them up again.
+	class BeJobSystem
+	{
+	public:
+		using JobFn = void (*)(void* data, uint32_t begin, uint32_t end);
+
+		// Jobs one thread can have queued at once, a push into a full deque runs the job inline instead
+		static constexpr uint32_t QUEUE_CAPACITY = 4096;
+
+		~BeJobSystem() { destroy(); }
+
+		// threadCount includes the calling thread, 0 uses every hardware thread. extraThreads reserves deques for
+		// threads that attach later.
+		void init(uint32_t threadCount = 0, uint32_t extraThreads = 0);
+		void destroy();
+
+		// Lets the calling thread submit and wait for jobs, one of the reserved extra deques becomes its own
+		void attachThread();
+
+		// Queues fn(data, begin, end) on the calling thread's deque. Only thread 0, attached threads and the job
+		// threads may submit.
+		void run(BeJobCounter& counter, JobFn fn, void* data, uint32_t begin, uint32_t end);
+		// Runs queued jobs, its own or stolen ones, until the counter drops to zero
+		void wait(BeJobCounter& counter);
+
+		// Calls fn(begin, end) for every grain sized range of [0, count) and returns once all ranges are done. The
+		// first exception thrown by a range is rethrown here.
+		template <typename Fn>
+		void parallelFor(uint32_t count, uint32_t grain, const Fn& fn);
+
+		// Threads that run jobs, not counting attached threads
+		uint32_t getThreadCount() const { return threadCount; }
+		// Jobs that ran on another thread than the one that queued them
+		uint64_t getStolenJobs() const { return stolenJobs.load(::std::memory_order_relaxed); }
+
+	private:
+		struct Job
+		{
+			JobFn fn;
+			void* data;
+			uint32_t begin;
+			uint32_t end;
+			BeJobCounter* counter;
+			// Set while the job is queued or running, its ring slot can't be reused until execute clears it
+			::std::atomic<bool> busy{ false };
+		};
+
+		// Chase-Lev deque: the owner pushes and pops at the bottom, thieves take from the top
+		class Deque
+		{
+		public:
+			bool push(Job* job);
+			Job* pop();
+			Job* steal();
+
+		private:
+			::std::atomic<int64_t> top{ 0 };
+			::std::atomic<int64_t> bottom{ 0 };
+			::std::atomic<Job*> slots[QUEUE_CAPACITY] = {};
+		};
+
+		struct Worker
+		{
+			Deque deque;
+			// Ring of job storage, owned by this thread. Twice the queue size, so the next slot is almost always free
+			// again by the time it comes around.
+			::std::vector<Job> jobs;
+			uint32_t nextJob = 0;
+			uint32_t random = 0;
+			::std::thread thread;
+		};
+
+		uint32_t currentThread() const;
+		Job* findJob(uint32_t thread);
+		void execute(Job* job);
+		void runInline(JobFn fn, void* data, uint32_t begin, uint32_t end, BeJobCounter& counter);
+		void workerLoop(uint32_t index);
+
+		::std::vector<::std::unique_ptr<Worker>> workers;
+		uint32_t threadCount = 0;
+		::std::atomic<uint32_t> attachedThreads{ 0 };
+		::std::thread::id ownerThread;
+		::std::atomic<bool> stopping{ false };
+		::std::atomic<int64_t> queuedJobs{ 0 };
+		::std::atomic<uint32_t> sleepingWorkers{ 0 };
+		::std::atomic<uint64_t> stolenJobs{ 0 };
+		::std::mutex sleepMutex;
+		::std::condition_variable wake;
+	};
+
+	template <typename Fn>
+	void BeJobSystem::parallelFor(uint32_t count, uint32_t grain, const Fn& fn)
+	{
+		if (count == 0)
+			return;
+
+		grain = grain > 0 ? grain : 1;
+		if (threadCount <= 1 || count <= grain)
+		{
+			fn(0u, count);
+			return;
+		}
+
+		struct Context
+		{
+			const Fn& fn;
+			::std::atomic<bool> failed;
+			::std::exception_ptr error;
+		};
+		Context context = { fn, { false }, nullptr };
+
+		JobFn range = [](void* data, uint32_t begin, uint32_t end) {
+			Context& context = *static_cast<Context*>(data);
+			try
+			{
+				context.fn(begin, end);
+			}
+			catch (...)
+			{
+				if (!context.failed.exchange(true))
+					context.error = ::std::current_exception();
+			}
+		};
+
+		BeJobCounter counter;
+		for (uint32_t begin = 0; begin < count; begin += grain)
+			run(counter, range, &context, begin, count - begin > grain ? begin + grain : count);
+		wait(counter);
+
+		if (context.error)
+			::std::rethrow_exception(context.error);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "be_latency.h"
+
+#include <algorithm>
+#include <string>
+
+namespace be {
+
+	// Buckets merged into one row of the printed histogram
+	static const uint32_t BUCKETS_PER_ROW = 4;
+	static const size_t BAR_WIDTH = 40;
+
+	void BeLatencyHistogram::add(double ms)
+	{
+		ms = std::max(ms, 0.0);
+		uint32_t bucket = std::min(static_cast<uint32_t>(ms / BUCKET_MS), BUCKET_COUNT);
+		buckets[bucket]++;
+
+		minMs = samples == 0 ? ms : std::min(minMs, ms);
+		maxMs = samples == 0 ? ms : std::max(maxMs, ms);
+		sumMs += ms;
+		samples++;
+	}
+
+	void BeLatencyHistogram::addSince(InputTimestamp input)
+	{
+		add((inputTimestampNow() - input) / 1e6);
+	}
+
+	double BeLatencyHistogram::percentile(double p) const
+	{
+		if (samples == 0)
+			return 0.0;
+
+		uint64_t target = static_cast<uint64_t>(p * samples);
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			seen += buckets[i];
+			if (seen > target)
+				return std::min((i + 1) * BUCKET_MS, maxMs);
+		}
+		return maxMs;
+	}
+
+	void BeLatencyHistogram::dump(std::ostream& out, const char* name) const
+	{
+		out << name << " latency over " << samples << " frames" << std::endl;
+		if (samples == 0)
+			return;
+
+		out << "  ms: min " << minMs << " avg " << sumMs / samples << " p50 " << percentile(0.5) << " p90 " << percentile(0.9)
+			<< " p99 " << percentile(0.99) << " max " << maxMs << std::endl;
+
+		uint64_t rows[BUCKET_COUNT / BUCKETS_PER_ROW + 1] = {};
+		uint64_t largest = 0;
+		for (uint32_t i = 0; i <= BUCKET_COUNT; i++)
+		{
+			uint64_t& row = rows[i / BUCKETS_PER_ROW];
+			row += buckets[i];
+			largest = std::max(largest, row);
+		}
+
+		// Empty rows are left out, outliers would otherwise drag dozens of them in
+		for (uint32_t row = 0; row <= BUCKET_COUNT / BUCKETS_PER_ROW; row++)
+		{
+			if (rows[row] == 0)
+				continue;
+
+			double from = row * BUCKET_MS * BUCKETS_PER_ROW;
+			if (row == BUCKET_COUNT / BUCKETS_PER_ROW)
+				out << "  >=" << from << "\t";
+			else
+				out << "  " << from << "-" << from + BUCKET_MS * BUCKETS_PER_ROW << "\t";
+			out << rows[row] << "\t" << std::string(static_cast<size_t>(rows[row] * BAR_WIDTH / largest), '#') << std::endl;
+		}
+	}
+}
\ No newline at end of file
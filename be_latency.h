@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace be
+{
+	// Steady clock time of an input event in nanoseconds, 0 for frames no input went into. On Windows the steady
+	// clock is QueryPerformanceCounter, so it's comparable across threads and fine grained enough for frame times.
+	using InputTimestamp = int64_t;
+
+	inline InputTimestamp inputTimestampNow()
+	{
+		return ::std::chrono::duration_cast<::std::chrono::nanoseconds>(::std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Latency samples in fixed half millisecond buckets, anything past the last bucket lands in an overflow bucket
+	class BeLatencyHistogram
+	{
+	public:
+		static constexpr double BUCKET_MS = 0.5;
+		static constexpr uint32_t BUCKET_COUNT = 200;
+
+		void add(double ms);
+		// Adds the time from input until now
+		void addSince(InputTimestamp input);
+
+		uint64_t count() const { return samples; }
+		// Upper edge of the bucket the p-th fraction of the samples falls in, capped by the largest sample
+		double percentile(double p) const;
+
+		void dump(::std::ostream& out, const char* name) const;
+
+	private:
+		uint64_t buckets[BUCKET_COUNT + 1] = {};
+		uint64_t samples = 0;
+		double sumMs = 0.0;
+		double minMs = 0.0;
+		double maxMs = 0.0;
+	};
+}
\ No newline at end of file
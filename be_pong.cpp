@@ -0,0 +1,203 @@
+#include "be_pong.h"
+
+namespace be {
+
+	using namespace pong;
+
+	static const Fixed FIELD_EDGE = FIXED_ONE;
+	static const Fixed PADDLE_SPEED = fixedRatio(3, 2 * BePongSim::TICK_RATE);
+	static const Fixed SERVE_SPEED_X = fixedRatio(2, 3 * BePongSim::TICK_RATE / 2);
+	static const Fixed MAX_SPEED_X = fixedRatio(4, BePongSim::TICK_RATE);
+	static const Fixed MAX_SPEED_Y = fixedRatio(2, BePongSim::TICK_RATE);
+	static const Fixed HIT_SPEEDUP = fixedRatio(17, 16);
+	static const uint32_t SERVE_DELAY_TICKS = BePongSim::TICK_RATE / 2;
+
+	static uint32_t nextRandom(uint32_t& state)
+	{
+		// xorshift32, state is never zero
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	static Fixed clampFixed(Fixed value, Fixed low, Fixed high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	static void resetBall(PongState& state, int32_t direction)
+	{
+		state.ballX = 0;
+		state.ballY = 0;
+		state.ballVX = 0;
+		state.ballVY = 0;
+		state.serveDelay = SERVE_DELAY_TICKS;
+		state.serveDirection = direction;
+	}
+
+	static void bounceOffPaddle(PongState& state, Fixed paddleY, Fixed faceX, int32_t direction)
+	{
+		state.ballX = faceX + direction * BALL_HALF_WIDTH;
+
+		Fixed speed = fixedMul(state.ballVX < 0 ? -state.ballVX : state.ballVX, HIT_SPEEDUP);
+		state.ballVX = direction * (speed < MAX_SPEED_X ? speed : MAX_SPEED_X);
+
+		// Where the ball hits the paddle decides the new vertical speed
+		Fixed offset = fixedDiv(state.ballY - paddleY, PADDLE_HALF_HEIGHT + BALL_HALF_HEIGHT);
+		state.ballVY = clampFixed(fixedMul(offset, MAX_SPEED_Y), -MAX_SPEED_Y, MAX_SPEED_Y);
+	}
+
+	PongState makePongState(uint32_t seed)
+	{
+		PongState state = {};
+		state.rng = seed != 0 ? seed : 0x9E3779B9u;
+		resetBall(state, (seed & 1) ? 1 : -1);
+		return state;
+	}
+
+	void stepPong(PongState& state, const PongInput& input)
+	{
+		state.tick++;
+
+		const int8_t moves[2] = { input.left, input.right };
+		for (int i = 0; i < 2; i++)
+		{
+			Fixed move = moves[i] < 0 ? -PADDLE_SPEED : (moves[i] > 0 ? PADDLE_SPEED : 0);
+			state.paddleY[i] = clampFixed(state.paddleY[i] + move, -FIELD_EDGE + PADDLE_HALF_HEIGHT, FIELD_EDGE - PADDLE_HALF_HEIGHT);
+		}
+
+		if (state.serveDelay > 0)
+		{
+			if (--state.serveDelay == 0)
+			{
+				// Serve angle in [-MAX_SPEED_Y / 2, MAX_SPEED_Y / 2)
+				Fixed spread = static_cast<Fixed>(nextRandom(state.rng) % static_cast<uint32_t>(MAX_SPEED_Y)) - MAX_SPEED_Y / 2;
+				state.ballVX = state.serveDirection * SERVE_SPEED_X;
+				state.ballVY = spread;
+			}
+			return;
+		}
+
+		state.ballX += state.ballVX;
+		state.ballY += state.ballVY;
+
+		Fixed top = -FIELD_EDGE + BALL_HALF_HEIGHT;
+		Fixed bottom = FIELD_EDGE - BALL_HALF_HEIGHT;
+		if (state.ballY < top)
+		{
+			state.ballY = 2 * top - state.ballY;
+			state.ballVY = -state.ballVY;
+		}
+		else if (state.ballY > bottom)
+		{
+			state.ballY = 2 * bottom - state.ballY;
+			state.ballVY = -state.ballVY;
+		}
+
+		// A paddle is hit if the ball's leading edge crossed its face during this tick
+		Fixed reach = PADDLE_HALF_HEIGHT + BALL_HALF_HEIGHT;
+		if (state.ballVX < 0)
+		{
+			Fixed face = -PADDLE_X + PADDLE_HALF_WIDTH;
+			Fixed edge = state.ballX - BALL_HALF_WIDTH;
+			Fixed offset = state.ballY - state.paddleY[0];
+			if (edge <= face && edge - state.ballVX > face && offset >= -reach && offset <= reach)
+				bounceOffPaddle(state, state.paddleY[0], face, 1);
+		}
+		else if (state.ballVX > 0)
+		{
+			Fixed face = PADDLE_X - PADDLE_HALF_WIDTH;
+			Fixed edge = state.ballX + BALL_HALF_WIDTH;
+			Fixed offset = state.ballY - state.paddleY[1];
+			if (edge >= face && edge - state.ballVX < face && offset >= -reach && offset <= reach)
+				bounceOffPaddle(state, state.paddleY[1], face, -1);
+		}
+
+		if (state.ballX < -FIELD_EDGE - BALL_HALF_WIDTH)
+		{
+			state.score[1]++;
+			resetBall(state, -1);
+		}
+		else if (state.ballX > FIELD_EDGE + BALL_HALF_WIDTH)
+		{
+			state.score[0]++;
+			resetBall(state, 1);
+		}
+	}
+
+	PongInput autoPongInput(const PongState& state)
+	{
+		PongInput input;
+		int8_t* moves[2] = { &input.left, &input.right };
+		const Fixed deadZone = PADDLE_HALF_HEIGHT / 4;
+
+		for (int i = 0; i < 2; i++)
+		{
+			// Track the ball while it approaches, drift back to the middle otherwise
+			bool approaching = i == 0 ? state.ballVX < 0 : state.ballVX > 0;
+			Fixed target = approaching ? state.ballY : 0;
+			Fixed delta = target - state.paddleY[i];
+
+			*moves[i] = delta < -deadZone ? -1 : (delta > deadZone ? 1 : 0);
+		}
+
+		return input;
+	}
+
+	uint64_t hashPongState(const PongState& state)
+	{
+		// FNV-1a over the fields, not the raw bytes, so the hash is independent of layout
+		const uint32_t fields[] = {
+			state.tick, state.rng,
+			static_cast<uint32_t>(state.paddleY[0]), static_cast<uint32_t>(state.paddleY[1]),
+			static_cast<uint32_t>(state.ballX), static_cast<uint32_t>(state.ballY),
+			static_cast<uint32_t>(state.ballVX), static_cast<uint32_t>(state.ballVY),
+			state.score[0], state.score[1],
+			state.serveDelay, static_cast<uint32_t>(state.serveDirection)
+		};
+
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t field : fields)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				hash ^= (field >> (8 * i)) & 0xFF;
+				hash *= 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	uint32_t BePongSim::advance(double seconds, const PongInput& input)
+	{
+		uint32_t ticks = takeTicks(seconds);
+		for (uint32_t t = 0; t < ticks; t++)
+			step(input);
+		return ticks;
+	}
+
+	uint32_t BePongSim::takeTicks(double seconds)
+	{
+		accumulator += seconds;
+
+		uint32_t ticks = 0;
+		while (accumulator >= TICK_SECONDS && ticks < MAX_TICKS_PER_ADVANCE)
+		{
+			accumulator -= TICK_SECONDS;
+			ticks++;
+		}
+
+		// Drop time that couldn't be simulated instead of carrying it into the next frames
+		if (accumulator >= TICK_SECONDS)
+			accumulator = 0.0;
+
+		return ticks;
+	}
+
+	void BePongSim::step(const PongInput& input)
+	{
+		previousState = currentState;
+		stepPong(currentState, input);
+	}
+}
\ No newline at end of file
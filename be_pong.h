@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+namespace be
+{
+	// 16.16 fixed point. The simulation only uses integer math, so a given seed and input sequence produces the
+	// same states on every run, compiler and CPU.
+	using Fixed = int32_t;
+
+	constexpr Fixed FIXED_ONE = 1 << 16;
+
+	constexpr Fixed fixedRatio(int32_t numerator, int32_t denominator)
+	{
+		return static_cast<Fixed>(static_cast<int64_t>(numerator) * FIXED_ONE / denominator);
+	}
+
+	constexpr Fixed fixedMul(Fixed a, Fixed b)
+	{
+		return static_cast<Fixed>((static_cast<int64_t>(a) * b) >> 16);
+	}
+
+	constexpr Fixed fixedDiv(Fixed a, Fixed b)
+	{
+		return static_cast<Fixed>(static_cast<int64_t>(a) * FIXED_ONE / b);
+	}
+
+	inline float fixedToFloat(Fixed value)
+	{
+		return static_cast<float>(value) * (1.0f / FIXED_ONE);
+	}
+
+	// Paddle directions for one tick: -1 up, 0 still, 1 down
+	struct PongInput
+	{
+		int8_t left = 0;
+		int8_t right = 0;
+	};
+
+	// Whole game state, in the renderer's clip space: x and y in [-1, 1], y pointing down
+	struct PongState
+	{
+		uint32_t tick;
+		uint32_t rng;
+		Fixed paddleY[2];
+		Fixed ballX;
+		Fixed ballY;
+		Fixed ballVX;
+		Fixed ballVY;
+		uint32_t score[2];
+		// Ticks left before the ball is served, and the side it is served towards (-1 left, 1 right)
+		uint32_t serveDelay;
+		int32_t serveDirection;
+	};
+
+	static_assert(::std::is_trivially_copyable<PongState>::value, "PongState must stay plain data");
+
+	namespace pong {
+		constexpr Fixed PADDLE_X = fixedRatio(9, 10);
+		constexpr Fixed PADDLE_HALF_WIDTH = fixedRatio(15, 1000);
+		constexpr Fixed PADDLE_HALF_HEIGHT = fixedRatio(15, 100);
+		constexpr Fixed BALL_HALF_WIDTH = fixedRatio(15, 1000);
+		constexpr Fixed BALL_HALF_HEIGHT = fixedRatio(2, 100);
+	}
+
+	PongState makePongState(uint32_t seed);
+	void stepPong(PongState& state, const PongInput& input);
+	// Simple paddle AI, a pure function of the state so headless runs stay deterministic
+	PongInput autoPongInput(const PongState& state);
+	uint64_t hashPongState(const PongState& state);
+
+	// Runs stepPong at a fixed rate independent of the render rate. Rendering interpolates between the last two
+	// states with alpha(), which never feeds back into the simulation.
+	class BePongSim
+	{
+	public:
+		static constexpr uint32_t TICK_RATE = 120;
+		static constexpr double TICK_SECONDS = 1.0 / TICK_RATE;
+		// Upper bound of ticks per advance, so a long stall doesn't turn into a spiral of catch up work
+		static constexpr uint32_t MAX_TICKS_PER_ADVANCE = 16;
+
+		explicit BePongSim(uint32_t seed = 1) : previousState(makePongState(seed)), currentState(previousState) {}
+
+		// Adds elapsed time and runs every whole tick it covers with the given input, returns the number of ticks run
+		uint32_t advance(double seconds, const PongInput& input);
+		// Adds elapsed time and returns the whole ticks it covers without running them, for callers that step themselves
+		uint32_t takeTicks(double seconds);
+		void step(const PongInput& input);
+
+		const PongState& previous() const { return previousState; }
+		const PongState& current() const { return currentState; }
+		float alpha() const { return static_cast<float>(accumulator / TICK_SECONDS); }
+
+	private:
+		PongState previousState;
+		PongState currentState;
+		double accumulator = 0.0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "be_profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace be {
+	namespace renderer {
+
+		// Timestamp layout of a frame: [0] frame begin, [1] frame end, then one begin/end pair per draw scope
+		static const uint32_t TIMESTAMP_FRAME_BEGIN = 0;
+		static const uint32_t TIMESTAMP_FRAME_END = 1;
+		static const uint32_t TIMESTAMP_FIRST_DRAW = 2;
+		static const uint32_t TIMESTAMP_COUNT = TIMESTAMP_FIRST_DRAW + 2 * BeProfiler::MAX_DRAW_SCOPES;
+
+		static const VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+		static const uint32_t STATISTICS_COUNT = 4;
+
+		void BeProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, bool pipelineStatistics)
+		{
+			this->device = device;
+
+			VkPhysicalDeviceProperties deviceProps;
+			vkGetPhysicalDeviceProperties(physicalDevice, &deviceProps);
+
+			uint32_t queueFamilyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+			std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+			uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+			timestampsSupported = validBits > 0 && deviceProps.limits.timestampPeriod > 0.0f;
+			timestampPeriodNs = deviceProps.limits.timestampPeriod;
+			timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+			statisticsSupported = pipelineStatistics;
+
+			frames.resize(framesInFlight);
+			for (auto& frame : frames)
+			{
+				if (timestampsSupported)
+				{
+					VkQueryPoolCreateInfo poolInfo = {};
+					poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+					poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+					poolInfo.queryCount = TIMESTAMP_COUNT;
+
+					if (vkCreateQueryPool(device, &poolInfo, nullptr, &frame.timestampPool) != VK_SUCCESS)
+						throw std::runtime_error("Failed to create timestamp query pool");
+				}
+
+				if (statisticsSupported)
+				{
+					VkQueryPoolCreateInfo poolInfo = {};
+					poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+					poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+					poolInfo.queryCount = 1;
+					poolInfo.pipelineStatistics = STATISTICS_FLAGS;
+
+					if (vkCreateQueryPool(device, &poolInfo, nullptr, &frame.statisticsPool) != VK_SUCCESS)
+						throw std::runtime_error("Failed to create pipeline statistics query pool");
+				}
+			}
+
+			ring.resize(HISTORY_SIZE);
+		}
+
+		void BeProfiler::destroy(VkDevice device)
+		{
+			for (auto& frame : frames)
+			{
+				vkDestroyQueryPool(device, frame.timestampPool, nullptr);
+				vkDestroyQueryPool(device, frame.statisticsPool, nullptr);
+			}
+
+			frames.clear();
+		}
+
+		void BeProfiler::beginFrame(uint32_t frameIndex)
+		{
+			auto now = std::chrono::steady_clock::now();
+
+			// The CPU time of a frame is only known once the next one starts
+			if (hasLastBegin)
+				frames[lastFrameIndex].cpuFrameMs = std::chrono::duration<double, std::milli>(now - lastBegin).count();
+
+			FrameQueries& frame = frames[frameIndex];
+			if (frame.pending)
+				resolve(frame);
+
+			frame.frameNumber = frameNumber++;
+			frame.drawScopes = 0;
+			frame.drawOpen = false;
+			frame.cpuFrameMs = 0.0;
+
+			lastFrameIndex = frameIndex;
+			lastBegin = now;
+			hasLastBegin = true;
+		}
+
+		void BeProfiler::resolvePending()
+		{
+			// The last frame's CPU time would have been taken by the next beginFrame
+			if (hasLastBegin)
+				frames[lastFrameIndex].cpuFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lastBegin).count();
+			hasLastBegin = false;
+
+			for (;;)
+			{
+				FrameQueries* oldest = nullptr;
+				for (auto& frame : frames)
+				{
+					if (frame.pending && (!oldest || frame.frameNumber < oldest->frameNumber))
+						oldest = &frame;
+				}
+
+				if (!oldest)
+					break;
+				resolve(*oldest);
+			}
+		}
+
+		void BeProfiler::cmdBeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+		{
+			FrameQueries& frame = frames[frameIndex];
+			frame.pending = true;
+			frame.drawScopes = 0;
+			frame.drawOpen = false;
+
+			if (timestampsSupported)
+			{
+				vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, TIMESTAMP_COUNT);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, TIMESTAMP_FRAME_BEGIN);
+			}
+
+			if (statisticsSupported)
+			{
+				vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, 1);
+				vkCmdBeginQuery(commandBuffer, frame.statisticsPool, 0, 0);
+			}
+		}
+
+		void BeProfiler::cmdEndFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+		{
+			FrameQueries& frame = frames[frameIndex];
+
+			if (statisticsSupported)
+				vkCmdEndQuery(commandBuffer, frame.statisticsPool, 0);
+
+			if (timestampsSupported)
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, TIMESTAMP_FRAME_END);
+		}
+
+		void BeProfiler::cmdBeginDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+		{
+			FrameQueries& frame = frames[frameIndex];
+			if (!timestampsSupported || frame.drawOpen || frame.drawScopes >= MAX_DRAW_SCOPES)
+				return;
+
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, TIMESTAMP_FIRST_DRAW + 2 * frame.drawScopes);
+			frame.drawOpen = true;
+		}
+
+		void BeProfiler::cmdEndDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+		{
+			FrameQueries& frame = frames[frameIndex];
+			if (!frame.drawOpen)
+				return;
+
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, TIMESTAMP_FIRST_DRAW + 2 * frame.drawScopes + 1);
+			frame.drawScopes++;
+			frame.drawOpen = false;
+		}
+
+		VkQueryPipelineStatisticFlags BeProfiler::inheritedStatistics() const
+		{
+			return statisticsSupported ? STATISTICS_FLAGS : 0;
+		}
+
+		void BeProfiler::replayFrame(uint32_t frameIndex, uint32_t drawScopes)
+		{
+			FrameQueries& frame = frames[frameIndex];
+			frame.pending = true;
+			frame.drawScopes = drawScopes;
+			frame.drawOpen = false;
+		}
+
+		void BeProfiler::resolve(FrameQueries& frame)
+		{
+			frame.pending = false;
+
+			FrameStats stats;
+			stats.frameNumber = frame.frameNumber;
+			stats.cpuFrameMs = frame.cpuFrameMs;
+			stats.drawCount = frame.drawScopes;
+
+			// The fence of this frame has been waited on, so no VK_QUERY_RESULT_WAIT_BIT is needed
+			if (timestampsSupported)
+			{
+				uint32_t queryCount = TIMESTAMP_FIRST_DRAW + 2 * frame.drawScopes;
+				std::vector<uint64_t> timestamps(queryCount);
+
+				VkResult result = vkGetQueryPoolResults(device, frame.timestampPool, 0, queryCount, timestamps.size() * sizeof(uint64_t),
+					timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+				if (result == VK_SUCCESS)
+				{
+					auto toMs = [&](uint64_t begin, uint64_t end) {
+						return static_cast<double>((end - begin) & timestampMask) * timestampPeriodNs / 1e6;
+					};
+
+					stats.gpuValid = true;
+					stats.gpuFrameMs = toMs(timestamps[TIMESTAMP_FRAME_BEGIN], timestamps[TIMESTAMP_FRAME_END]);
+					for (uint32_t i = 0; i < frame.drawScopes; i++)
+						stats.gpuDrawMs += toMs(timestamps[TIMESTAMP_FIRST_DRAW + 2 * i], timestamps[TIMESTAMP_FIRST_DRAW + 2 * i + 1]);
+				}
+			}
+
+			if (statisticsSupported)
+			{
+				uint64_t statistics[STATISTICS_COUNT] = {};
+
+				VkResult result = vkGetQueryPoolResults(device, frame.statisticsPool, 0, 1, sizeof(statistics),
+					statistics, sizeof(statistics), VK_QUERY_RESULT_64_BIT);
+
+				if (result == VK_SUCCESS)
+				{
+					// Results are written in order of the flag bits
+					stats.statisticsValid = true;
+					stats.inputAssemblyVertices = statistics[0];
+					stats.vertexShaderInvocations = statistics[1];
+					stats.clippingPrimitives = statistics[2];
+					stats.fragmentShaderInvocations = statistics[3];
+				}
+			}
+
+			ring[ringHead] = stats;
+			ringHead = (ringHead + 1) % ring.size();
+			ringCount = std::min(ringCount + 1, ring.size());
+		}
+
+		const FrameStats* BeProfiler::latest() const
+		{
+			if (ringCount == 0)
+				return nullptr;
+
+			return &ring[(ringHead + ring.size() - 1) % ring.size()];
+		}
+
+		std::vector<FrameStats> BeProfiler::history() const
+		{
+			std::vector<FrameStats> result;
+			result.reserve(ringCount);
+
+			size_t first = (ringHead + ring.size() - ringCount) % ring.size();
+			for (size_t i = 0; i < ringCount; i++)
+				result.push_back(ring[(first + i) % ring.size()]);
+
+			return result;
+		}
+
+		FrameTimeSummary BeProfiler::summarize(bool gpu) const
+		{
+			std::vector<double> samples;
+			samples.reserve(ringCount);
+
+			for (const auto& stats : history())
+			{
+				if (gpu && !stats.gpuValid)
+					continue;
+
+				samples.push_back(gpu ? stats.gpuFrameMs : stats.cpuFrameMs);
+			}
+
+			FrameTimeSummary summary;
+			if (samples.empty())
+				return summary;
+
+			std::sort(samples.begin(), samples.end());
+
+			double total = 0.0;
+			for (double sample : samples)
+				total += sample;
+
+			size_t p99Index = static_cast<size_t>(std::ceil(0.99 * samples.size())) - 1;
+
+			summary.samples = samples.size();
+			summary.minMs = samples.front();
+			summary.avgMs = total / samples.size();
+			summary.p99Ms = samples[p99Index];
+
+			return summary;
+		}
+
+		FrameTimeSummary BeProfiler::cpuSummary() const
+		{
+			return summarize(false);
+		}
+
+		FrameTimeSummary BeProfiler::gpuSummary() const
+		{
+			return summarize(true);
+		}
+
+		void BeProfiler::dump(std::ostream& out) const
+		{
+			auto cpu = cpuSummary();
+			auto gpu = gpuSummary();
+
+			out << "frame stats over " << cpu.samples << " frames" << std::endl;
+			out << "  cpu ms: min " << cpu.minMs << " avg " << cpu.avgMs << " p99 " << cpu.p99Ms << std::endl;
+
+			if (gpu.samples > 0)
+				out << "  gpu ms: min " << gpu.minMs << " avg " << gpu.avgMs << " p99 " << gpu.p99Ms << std::endl;
+			else
+				out << "  gpu ms: timestamps not supported" << std::endl;
+
+			const FrameStats* last = latest();
+			if (last && last->statisticsValid)
+			{
+				out << "  last frame: " << last->inputAssemblyVertices << " vertices, " << last->vertexShaderInvocations << " vs invocations, "
+					<< last->clippingPrimitives << " primitives, " << last->fragmentShaderInvocations << " fs invocations" << std::endl;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <chrono>
+#include <ostream>
+
+namespace be
+{
+	namespace renderer {
+
+		struct FrameStats
+		{
+			uint64_t frameNumber = 0;
+			double cpuFrameMs = 0.0;
+
+			// Only meaningful if gpuValid is set, the device may not support timestamps
+			bool gpuValid = false;
+			double gpuFrameMs = 0.0;
+			double gpuDrawMs = 0.0;
+			uint32_t drawCount = 0;
+
+			bool statisticsValid = false;
+			uint64_t inputAssemblyVertices = 0;
+			uint64_t vertexShaderInvocations = 0;
+			uint64_t clippingPrimitives = 0;
+			uint64_t fragmentShaderInvocations = 0;
+		};
+
+		struct FrameTimeSummary
+		{
+			size_t samples = 0;
+			double minMs = 0.0;
+			double avgMs = 0.0;
+			double p99Ms = 0.0;
+		};
+
+		// Per frame in flight timestamp and pipeline statistics queries. Results of a frame are read back
+		// when its in flight fence has been waited on again, so reading never stalls the CPU.
+		class BeProfiler
+		{
+		public:
+			static constexpr uint32_t MAX_DRAW_SCOPES = 32;
+			static constexpr size_t HISTORY_SIZE = 1024;
+
+			void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, bool pipelineStatistics);
+			void destroy(VkDevice device);
+
+			// Call right after the frame's in flight fence has been waited on
+			void beginFrame(uint32_t frameIndex);
+			// Reads back every frame still pending, in frame order. Call with the device idle, before the frames in
+			// flight shrink and leave slots that beginFrame would not get back to.
+			void resolvePending();
+
+			// Must be recorded outside of a render pass
+			void cmdBeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+			void cmdEndFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+			void cmdBeginDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+			void cmdEndDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+			// For command buffers that are recorded once and submitted again: the query commands are replayed as is,
+			// only the number of draw scopes recorded the first time has to be restored
+			uint32_t recordedDrawScopes(uint32_t frameIndex) const { return frames[frameIndex].drawScopes; }
+			void replayFrame(uint32_t frameIndex, uint32_t drawScopes);
+
+			bool hasGpuTimestamps() const { return timestampsSupported; }
+			bool hasPipelineStatistics() const { return statisticsSupported; }
+			// Statistics secondary command buffers have to declare when executed inside the frame's query
+			VkQueryPipelineStatisticFlags inheritedStatistics() const;
+
+			const FrameStats* latest() const;
+			::std::vector<FrameStats> history() const;
+
+			FrameTimeSummary cpuSummary() const;
+			FrameTimeSummary gpuSummary() const;
+
+			void dump(::std::ostream& out) const;
+
+		private:
+			struct FrameQueries
+			{
+				VkQueryPool timestampPool = VK_NULL_HANDLE;
+				VkQueryPool statisticsPool = VK_NULL_HANDLE;
+				uint32_t drawScopes = 0;
+				bool drawOpen = false;
+				bool pending = false;
+				uint64_t frameNumber = 0;
+				double cpuFrameMs = 0.0;
+			};
+
+			void resolve(FrameQueries& frame);
+			FrameTimeSummary summarize(bool gpu) const;
+
+			VkDevice device = VK_NULL_HANDLE;
+			bool timestampsSupported = false;
+			bool statisticsSupported = false;
+			double timestampPeriodNs = 1.0;
+			uint64_t timestampMask = ~0ull;
+
+			::std::vector<FrameQueries> frames;
+			uint32_t lastFrameIndex = 0;
+			uint64_t frameNumber = 0;
+			bool hasLastBegin = false;
+			::std::chrono::steady_clock::time_point lastBegin;
+
+			::std::vector<FrameStats> ring;
+			size_t ringHead = 0;
+			size_t ringCount = 0;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace be
+{
+	// Blocking FIFO with a fixed capacity, used to hand frame snapshots between pipeline stages. Once closed, push
+	// fails and pop drains what is left before failing too, so either side can end the pipeline.
+	template <typename T>
+	class BeBoundedQueue
+	{
+	public:
+		void reset(size_t capacity)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			this->capacity = capacity;
+			items.clear();
+			closed = false;
+		}
+
+		// Blocks while the queue is full, returns false if the queue was closed
+		bool push(T item)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+			if (closed)
+				return false;
+
+			items.push_back(std::move(item));
+			lock.unlock();
+			notEmpty.notify_one();
+			return true;
+		}
+
+		// Blocks while the queue is empty, returns false once it is closed and drained
+		bool pop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+			if (items.empty())
+				return false;
+
+			item = std::move(items.front());
+			items.pop_front();
+			lock.unlock();
+			notFull.notify_one();
+			return true;
+		}
+
+		// Like pop, but returns false right away instead of blocking while the queue is empty
+		bool tryPop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (items.empty())
+				return false;
+
+			item = std::move(items.front());
+			items.pop_front();
+			lock.unlock();
+			notFull.notify_one();
+			return true;
+		}
+
+		void close()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				closed = true;
+			}
+			notFull.notify_all();
+			notEmpty.notify_all();
+		}
+
+	private:
+		std::mutex mutex;
+		std::condition_variable notFull;
+		std::condition_variable notEmpty;
+		std::deque<T> items;
+		size_t capacity = 0;
+		bool closed = false;
+	};
+}
\ No newline at end of file
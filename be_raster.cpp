@@ -0,0 +1,73 @@
+#include "be_raster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace be {
+	namespace renderer {
+
+		static const int64_t SUBPIXELS = 256;
+
+		static uint8_t toUnorm(float value)
+		{
+			return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+		}
+
+		static uint8_t toSrgb(float value)
+		{
+			value = std::min(std::max(value, 0.0f), 1.0f);
+			return toUnorm(value <= 0.0031308f ? 12.92f * value : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f);
+		}
+
+		// Viewport transform of one axis, in subpixels
+		static int64_t snap(float ndc, uint32_t size)
+		{
+			return static_cast<int64_t>(std::lround((ndc + 1.0f) * 0.5f * static_cast<float>(size) * SUBPIXELS));
+		}
+
+		// First pixel whose center is at or past edge
+		static int64_t firstCenter(int64_t edge)
+		{
+			int64_t offset = edge - SUBPIXELS / 2;
+			return offset >= 0 ? (offset + SUBPIXELS - 1) / SUBPIXELS : -(-offset / SUBPIXELS);
+		}
+
+		RgbaImage rasterizeBatch(const BeQuadBatch& batch, uint32_t width, uint32_t height, const VkClearColorValue& clearColor)
+		{
+			RgbaImage image;
+			image.width = width;
+			image.height = height;
+			image.pixels.resize(static_cast<size_t>(width) * height * 4);
+
+			uint8_t clear[4] = { toSrgb(clearColor.float32[0]), toSrgb(clearColor.float32[1]), toSrgb(clearColor.float32[2]), toUnorm(clearColor.float32[3]) };
+			for (size_t i = 0; i < image.pixels.size(); i += 4)
+				memcpy(&image.pixels[i], clear, 4);
+
+			for (size_t q = 0; q < batch.size(); q++)
+			{
+				// The corners of the unit quad, computed like shader.vert does
+				const QuadInstance& quad = batch.data()[q];
+				int64_t left = snap(quad.position.x + -0.5f * quad.size.x, width);
+				int64_t right = snap(quad.position.x + 0.5f * quad.size.x, width);
+				int64_t top = snap(quad.position.y + -0.5f * quad.size.y, height);
+				int64_t bottom = snap(quad.position.y + 0.5f * quad.size.y, height);
+
+				// Centers on the left and top edges are covered, those on the right and bottom edges aren't
+				int64_t x0 = std::max<int64_t>(firstCenter(std::min(left, right)), 0);
+				int64_t x1 = std::min<int64_t>(firstCenter(std::max(left, right)), width);
+				int64_t y0 = std::max<int64_t>(firstCenter(std::min(top, bottom)), 0);
+				int64_t y1 = std::min<int64_t>(firstCenter(std::max(top, bottom)), height);
+
+				uint8_t color[4] = { toSrgb(quad.color.x), toSrgb(quad.color.y), toSrgb(quad.color.z), toUnorm(quad.color.w) };
+				for (int64_t y = y0; y < y1; y++)
+				{
+					for (int64_t x = x0; x < x1; x++)
+						memcpy(&image.pixels[(static_cast<size_t>(y) * width + x) * 4], color, 4);
+				}
+			}
+
+			return image;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "be_batch.h"
+#include "be_image.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace be
+{
+	namespace renderer {
+
+		// Draws a batch on the CPU the way the scene pass does on a conforming device: quads of shader.vert snapped
+		// to 8 subpixel bits, covering the pixels whose centers they contain under the top-left rule, written in batch
+		// order without blending and encoded to sRGB. Reference images for the regression run without a device.
+		RgbaImage rasterizeBatch(const BeQuadBatch& batch, uint32_t width, uint32_t height, const VkClearColorValue& clearColor);
+	}
+}
\ No newline at end of file
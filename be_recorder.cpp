@@ -0,0 +1,137 @@
+#include "be_recorder.h"
+
+#include <stdexcept>
+
+namespace be {
+	namespace renderer {
+
+		void BeParallelRecorder::init(VkDevice device, uint32_t queueFamily, BeJobSystem* jobs, uint32_t rangeCount, uint32_t slotCount)
+		{
+			this->device = device;
+			this->queueFamily = queueFamily;
+			this->jobs = jobs;
+
+			if (rangeCount == 0)
+				throw std::runtime_error("parallel recorder needs at least one range");
+
+			ranges = std::vector<Range>(rangeCount);
+			for (auto& range : ranges)
+				createPools(range, slotCount);
+		}
+
+		void BeParallelRecorder::destroy()
+		{
+			for (auto& range : ranges)
+				destroyPools(range);
+			ranges.clear();
+			recorded.clear();
+		}
+
+		void BeParallelRecorder::resize(uint32_t slotCount, std::vector<VkCommandPool>* retired)
+		{
+			for (auto& range : ranges)
+			{
+				if (retired != nullptr)
+				{
+					retired->insert(retired->end(), range.pools.begin(), range.pools.end());
+					range.pools.clear();
+					range.buffers.clear();
+				}
+				else
+					destroyPools(range);
+
+				createPools(range, slotCount);
+			}
+		}
+
+		void BeParallelRecorder::createPools(Range& range, uint32_t slotCount)
+		{
+			range.pools.resize(slotCount, VK_NULL_HANDLE);
+			range.buffers.resize(slotCount, VK_NULL_HANDLE);
+
+			for (uint32_t i = 0; i < slotCount; i++)
+			{
+				// Every recording resets the whole pool, which is cheaper than resetting individual buffers
+				VkCommandPoolCreateInfo poolInfo = {};
+				poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+				poolInfo.flags = 0;
+				poolInfo.queueFamilyIndex = queueFamily;
+
+				if (vkCreateCommandPool(device, &poolInfo, nullptr, &range.pools[i]) != VK_SUCCESS)
+					throw std::runtime_error("failed to create recording command pool");
+
+				VkCommandBufferAllocateInfo allocInfo = {};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.commandPool = range.pools[i];
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				allocInfo.commandBufferCount = 1;
+
+				if (vkAllocateCommandBuffers(device, &allocInfo, &range.buffers[i]) != VK_SUCCESS)
+					throw std::runtime_error("failed to allocate secondary command buffer");
+			}
+		}
+
+		void BeParallelRecorder::destroyPools(Range& range)
+		{
+			for (auto pool : range.pools)
+				vkDestroyCommandPool(device, pool, nullptr);
+			range.pools.clear();
+			range.buffers.clear();
+		}
+
+		const std::vector<VkCommandBuffer>& BeParallelRecorder::record(uint32_t slot, const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const RecordFn& fn)
+		{
+			uint32_t rangeCount = static_cast<uint32_t>(ranges.size());
+			uint32_t perRange = itemCount / rangeCount;
+			uint32_t extra = itemCount % rangeCount;
+
+			uint32_t first = 0;
+			for (uint32_t i = 0; i < rangeCount; i++)
+			{
+				ranges[i].first = first;
+				ranges[i].count = perRange + (i < extra ? 1 : 0);
+				first += ranges[i].count;
+			}
+
+			auto recordRanges = [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++)
+					recordRange(ranges[i], slot, inheritance, fn);
+			};
+
+			if (jobs != nullptr)
+				jobs->parallelFor(rangeCount, 1, recordRanges);
+			else
+				recordRanges(0, rangeCount);
+
+			recorded.clear();
+			for (const auto& range : ranges)
+			{
+				if (range.count > 0)
+					recorded.push_back(range.buffers[slot]);
+			}
+			return recorded;
+		}
+
+		void BeParallelRecorder::recordRange(Range& range, uint32_t slot, const VkCommandBufferInheritanceInfo& inheritance, const RecordFn& fn)
+		{
+			if (range.count == 0)
+				return;
+
+			vkResetCommandPool(device, range.pools[slot], 0);
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			beginInfo.pInheritanceInfo = &inheritance;
+
+			VkCommandBuffer commandBuffer = range.buffers[slot];
+			if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+				throw std::runtime_error("Failed to begin recording secondary command buffer");
+
+			fn(commandBuffer, range.first, range.count);
+
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+				throw std::runtime_error("Failed to end secondary command buffer");
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "be_jobs.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <vector>
+
+namespace be
+{
+	namespace renderer {
+
+		// Records secondary command buffers as jobs on the job system, one buffer per range of draws. Every range owns
+		// one command pool per slot (a frame in flight and swapchain image pair), so re-recording a slot never touches
+		// buffers that another slot may still have in flight. A range only ever runs on one thread at a time, which
+		// is all the external synchronization its pools need.
+		class BeParallelRecorder
+		{
+		public:
+			// Records items [first, first + count) into a secondary command buffer that continues a render pass
+			using RecordFn = ::std::function<void(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count)>;
+
+			// Without a job system the ranges are recorded one after another on the calling thread
+			void init(VkDevice device, uint32_t queueFamily, BeJobSystem* jobs, uint32_t rangeCount, uint32_t slotCount);
+			void destroy();
+
+			// Recreates the per slot pools. The old pools are handed to retired when given, for the caller to destroy once
+			// the device is done with them, otherwise they are destroyed here and none of the slots may be in use.
+			void resize(uint32_t slotCount, ::std::vector<VkCommandPool>* retired = nullptr);
+
+			// Splits [0, itemCount) into contiguous ranges and records them in parallel. The returned buffers are in
+			// range order, ready for vkCmdExecuteCommands, and stay valid until the slot is recorded again.
+			const ::std::vector<VkCommandBuffer>& record(uint32_t slot, const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const RecordFn& fn);
+
+			uint32_t getRangeCount() const { return static_cast<uint32_t>(ranges.size()); }
+
+		private:
+			struct Range
+			{
+				::std::vector<VkCommandPool> pools;
+				::std::vector<VkCommandBuffer> buffers;
+				uint32_t first = 0;
+				uint32_t count = 0;
+			};
+
+			void createPools(Range& range, uint32_t slotCount);
+			void destroyPools(Range& range);
+			void recordRange(Range& range, uint32_t slot, const VkCommandBufferInheritanceInfo& inheritance, const RecordFn& fn);
+
+			VkDevice device = VK_NULL_HANDLE;
+			uint32_t queueFamily = 0;
+			BeJobSystem* jobs = nullptr;
+			::std::vector<Range> ranges;
+			::std::vector<VkCommandBuffer> recorded;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,689 @@
+#include "be_render_graph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace be {
+	namespace renderer {
+
+		struct UsageState
+		{
+			VkImageLayout layout;
+			VkPipelineStageFlags stage;
+			VkAccessFlags access;
+			// The part of access that writes, empty for read only usages
+			VkAccessFlags writeAccess;
+			VkImageUsageFlags imageUsage;
+		};
+
+		static UsageState usageState(ImageUsage usage)
+		{
+			switch (usage)
+			{
+			case ImageUsage::ColorAttachment:
+				return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+			case ImageUsage::Sampled:
+				return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_USAGE_SAMPLED_BIT };
+			case ImageUsage::TransferSrc:
+				return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+			case ImageUsage::TransferDst:
+				return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+			default:
+				// The present engine's reads are ordered by the semaphore the present waits on
+				return { VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, 0 };
+			}
+		}
+
+		static void appendObjects(RenderGraphObjects& to, RenderGraphObjects& from)
+		{
+			to.renderPasses.insert(to.renderPasses.end(), from.renderPasses.begin(), from.renderPasses.end());
+			to.framebuffers.insert(to.framebuffers.end(), from.framebuffers.begin(), from.framebuffers.end());
+			to.imageViews.insert(to.imageViews.end(), from.imageViews.begin(), from.imageViews.end());
+			to.images.insert(to.images.end(), from.images.begin(), from.images.end());
+			to.allocations.insert(to.allocations.end(), from.allocations.begin(), from.allocations.end());
+			from = {};
+		}
+
+		void BeRenderGraph::init(VkDevice device, BeAllocator* allocator)
+		{
+			this->device = device;
+			this->allocator = allocator;
+		}
+
+		void BeRenderGraph::destroy()
+		{
+			if (device == VK_NULL_HANDLE)
+				return;
+
+			releaseFramebuffers(objects);
+			destroyObjects(objects);
+
+			resources.clear();
+			passes.clear();
+			order.clear();
+			finalBarriers.clear();
+			compiled = false;
+			declarationsChanged = importsChanged = true;
+		}
+
+		void BeRenderGraph::setDynamicRendering(bool enabled)
+		{
+			if (enabled != dynamicRendering)
+				declarationsChanged = true;
+			dynamicRendering = enabled;
+		}
+
+		BeRenderGraph::Resource BeRenderGraph::importImage(const char* name, VkFormat format, VkPipelineStageFlags waitStage, ImageUsage finalUsage)
+		{
+			ResourceDesc resource;
+			resource.name = name;
+			resource.format = format;
+			resource.imported = true;
+			resource.waitStage = waitStage;
+			resource.finalUsage = finalUsage;
+			resources.push_back(resource);
+
+			declarationsChanged = true;
+			return static_cast<Resource>(resources.size() - 1);
+		}
+
+		void BeRenderGraph::setImportedImages(Resource resource, const std::vector<VkImage>& images, const std::vector<VkImageView>& views)
+		{
+			resources[resource].images = images;
+			resources[resource].views = views;
+			importsChanged = true;
+		}
+
+		BeRenderGraph::Resource BeRenderGraph::createTransient(const char* name, VkFormat format)
+		{
+			ResourceDesc resource;
+			resource.name = name;
+			resource.format = format;
+			resources.push_back(resource);
+
+			declarationsChanged = true;
+			return static_cast<Resource>(resources.size() - 1);
+		}
+
+		BeRenderGraph::Pass BeRenderGraph::addRasterPass(const char* name, const std::vector<ColorAttachment>& colors, const std::vector<ImageAccess>& reads, bool secondary, RecordFn record)
+		{
+			PassDesc pass;
+			pass.name = name;
+			pass.raster = true;
+			pass.secondary = secondary;
+			pass.colors = colors;
+			pass.record = std::move(record);
+
+			for (const auto& color : colors)
+				pass.accesses.push_back({ color.resource, ImageUsage::ColorAttachment });
+			pass.accesses.insert(pass.accesses.end(), reads.begin(), reads.end());
+			passes.push_back(std::move(pass));
+
+			declarationsChanged = true;
+			return static_cast<Pass>(passes.size() - 1);
+		}
+
+		BeRenderGraph::Pass BeRenderGraph::addPass(const char* name, const std::vector<ImageAccess>& accesses, RecordFn record)
+		{
+			PassDesc pass;
+			pass.name = name;
+			pass.accesses = accesses;
+			pass.record = std::move(record);
+			passes.push_back(std::move(pass));
+
+			declarationsChanged = true;
+			return static_cast<Pass>(passes.size() - 1);
+		}
+
+		void BeRenderGraph::compile(VkExtent2D extent, RenderGraphObjects* retired)
+		{
+			bool resized = extent.width != this->extent.width || extent.height != this->extent.height;
+			RenderGraphObjects replaced;
+
+			if (!compiled || declarationsChanged || resized)
+			{
+				releaseFramebuffers(replaced);
+				appendObjects(replaced, objects);
+
+				this->extent = extent;
+				sortPasses();
+				planBarriers();
+				createTransients();
+				createRenderPasses();
+			}
+			else if (importsChanged)
+				releaseFramebuffers(replaced);
+			else
+				return;
+
+			createFramebuffers();
+			compiled = true;
+			declarationsChanged = importsChanged = false;
+
+			if (retired != nullptr)
+				appendObjects(*retired, replaced);
+			else
+				destroyObjects(replaced);
+		}
+
+		std::vector<VkFormat> BeRenderGraph::getColorFormats(Pass pass) const
+		{
+			std::vector<VkFormat> formats;
+			for (const auto& color : passes[pass].colors)
+				formats.push_back(resources[color.resource].format);
+			return formats;
+		}
+
+		void BeRenderGraph::destroyObjects(RenderGraphObjects& objects)
+		{
+			for (auto framebuffer : objects.framebuffers)
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			for (auto renderPass : objects.renderPasses)
+				vkDestroyRenderPass(device, renderPass, nullptr);
+			for (auto view : objects.imageViews)
+				vkDestroyImageView(device, view, nullptr);
+			// Aliased images share an allocation, so images and memory are released separately
+			for (auto image : objects.images)
+				vkDestroyImage(device, image, nullptr);
+			for (auto& allocation : objects.allocations)
+				allocator->free(allocation);
+
+			objects = {};
+		}
+
+		void BeRenderGraph::sortPasses()
+		{
+			// Passes that read an image run after every pass writing it, passes writing the same image keep their
+			// declaration order. Among the passes that are ready the earliest declared goes first.
+			std::vector<std::vector<Pass>> dependencies(passes.size());
+			for (Pass pass = 0; pass < passes.size(); pass++)
+			{
+				for (const auto& access : passes[pass].accesses)
+				{
+					bool reads = usageState(access.usage).writeAccess == 0;
+					for (Pass other = 0; other < passes.size(); other++)
+					{
+						if (other == pass || (!reads && other > pass))
+							continue;
+
+						for (const auto& otherAccess : passes[other].accesses)
+						{
+							if (otherAccess.resource == access.resource && usageState(otherAccess.usage).writeAccess != 0)
+							{
+								dependencies[pass].push_back(other);
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			order.clear();
+			std::vector<bool> done(passes.size(), false);
+			while (order.size() < passes.size())
+			{
+				Pass next = static_cast<Pass>(passes.size());
+				for (Pass pass = 0; pass < passes.size() && next == passes.size(); pass++)
+				{
+					if (!done[pass] && std::all_of(dependencies[pass].begin(), dependencies[pass].end(), [&done](Pass dependency) { return done[dependency]; }))
+						next = pass;
+				}
+
+				if (next == passes.size())
+					throw std::runtime_error("render graph passes depend on each other in a cycle");
+
+				done[next] = true;
+				order.push_back(next);
+			}
+		}
+
+		void BeRenderGraph::planBarriers()
+		{
+			for (auto& resource : resources)
+			{
+				resource.usageFlags = 0;
+				resource.firstUse = UINT32_MAX;
+				resource.lastUse = 0;
+			}
+
+			for (uint32_t position = 0; position < order.size(); position++)
+			{
+				const PassDesc& pass = passes[order[position]];
+				for (size_t i = 0; i < pass.accesses.size(); i++)
+				{
+					ResourceDesc& resource = resources[pass.accesses[i].resource];
+					resource.usageFlags |= usageState(pass.accesses[i].usage).imageUsage;
+					resource.firstUse = std::min(resource.firstUse, position);
+					resource.lastUse = std::max(resource.lastUse, position);
+
+					for (size_t j = 0; j < i; j++)
+					{
+						if (pass.accesses[j].resource == pass.accesses[i].resource)
+							throw std::runtime_error("render graph pass " + pass.name + " uses " + resource.name + " twice");
+					}
+				}
+			}
+
+			planAliasing();
+
+			// Where each image is left, and the stages that accessed it since its last barrier
+			struct State
+			{
+				VkImageLayout layout;
+				VkPipelineStageFlags stages;
+				VkAccessFlags writeAccess;
+			};
+
+			std::vector<State> states(resources.size());
+			for (size_t i = 0; i < resources.size(); i++)
+				states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, resources[i].imported ? resources[i].waitStage : 0, 0 };
+
+			for (uint32_t position = 0; position < order.size(); position++)
+			{
+				PassDesc& pass = passes[order[position]];
+				pass.barriers.clear();
+				pass.loadOps.clear();
+				pass.storeOps.clear();
+
+				for (const auto& color : pass.colors)
+				{
+					// Only keep contents something wrote before, and only store them when something comes after
+					bool written = states[color.resource].layout != VK_IMAGE_LAYOUT_UNDEFINED;
+					pass.loadOps.push_back(color.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : (written ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE));
+					const ResourceDesc& resource = resources[color.resource];
+					pass.storeOps.push_back(resource.imported || resource.lastUse > position ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+				}
+
+				for (const auto& access : pass.accesses)
+				{
+					UsageState usage = usageState(access.usage);
+					State& state = states[access.resource];
+
+					// Reads in the same layout as earlier reads need nothing between them
+					if (state.layout == usage.layout && state.writeAccess == 0 && usage.writeAccess == 0)
+					{
+						state.stages |= usage.stage;
+						continue;
+					}
+
+					pass.barriers.push_back({ access.resource, state.layout, usage.layout, state.stages, usage.stage, state.writeAccess, usage.access });
+					state = { usage.layout, usage.stage, usage.writeAccess };
+				}
+			}
+
+			// A transient's contents are never kept, but its memory was last used by the previous image of its alias
+			// group, or by the group's last image in the frame before. Its first barrier, always a transition out of
+			// UNDEFINED, waits for those accesses.
+			for (uint32_t group = 0; group < aliasGroupCount; group++)
+			{
+				std::vector<Resource> members;
+				for (Resource resource = 0; resource < resources.size(); resource++)
+				{
+					const ResourceDesc& desc = resources[resource];
+					if (!desc.imported && desc.firstUse != UINT32_MAX && desc.aliasGroup == group)
+						members.push_back(resource);
+				}
+				// Lifetimes within a group don't overlap, so this is also the order they are used in
+				std::sort(members.begin(), members.end(), [this](Resource a, Resource b) { return resources[a].firstUse < resources[b].firstUse; });
+
+				for (size_t i = 0; i < members.size(); i++)
+				{
+					Resource previous = members[(i + members.size() - 1) % members.size()];
+					for (auto& barrier : passes[order[resources[members[i]].firstUse]].barriers)
+					{
+						if (barrier.resource == members[i])
+						{
+							barrier.srcStage = states[previous].stages;
+							barrier.srcAccess = states[previous].writeAccess;
+						}
+					}
+				}
+			}
+
+			finalBarriers.clear();
+			for (Resource resource = 0; resource < resources.size(); resource++)
+			{
+				const State& state = states[resource];
+				if (!resources[resource].imported || state.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+					continue;
+
+				UsageState usage = usageState(resources[resource].finalUsage);
+				if (state.layout != usage.layout || state.writeAccess != 0)
+					finalBarriers.push_back({ resource, state.layout, usage.layout, state.stages, usage.stage, state.writeAccess, usage.access });
+			}
+		}
+
+		void BeRenderGraph::planAliasing()
+		{
+			// Greedy interval colouring: a transient joins the first group whose images are all done before it starts
+			std::vector<Resource> transients;
+			for (Resource resource = 0; resource < resources.size(); resource++)
+			{
+				if (!resources[resource].imported && resources[resource].firstUse != UINT32_MAX)
+					transients.push_back(resource);
+			}
+			std::stable_sort(transients.begin(), transients.end(), [this](Resource a, Resource b) { return resources[a].firstUse < resources[b].firstUse; });
+
+			std::vector<uint32_t> groupEnds;
+			for (Resource resource : transients)
+			{
+				ResourceDesc& desc = resources[resource];
+				uint32_t group = 0;
+				while (group < groupEnds.size() && groupEnds[group] >= desc.firstUse)
+					group++;
+
+				if (group == groupEnds.size())
+					groupEnds.push_back(desc.lastUse);
+				else
+					groupEnds[group] = desc.lastUse;
+				desc.aliasGroup = group;
+			}
+
+			aliasGroupCount = static_cast<uint32_t>(groupEnds.size());
+		}
+
+		void BeRenderGraph::createTransients()
+		{
+			for (uint32_t group = 0; group < aliasGroupCount; group++)
+			{
+				std::vector<Resource> members;
+				VkMemoryRequirements requirements = {};
+				requirements.memoryTypeBits = ~0u;
+				requirements.alignment = 1;
+
+				for (Resource resource = 0; resource < resources.size(); resource++)
+				{
+					ResourceDesc& desc = resources[resource];
+					if (desc.imported || desc.firstUse == UINT32_MAX || desc.aliasGroup != group)
+						continue;
+
+					VkImageCreateInfo imageInfo = {};
+					imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+					imageInfo.imageType = VK_IMAGE_TYPE_2D;
+					imageInfo.format = desc.format;
+					imageInfo.extent = { extent.width, extent.height, 1 };
+					imageInfo.mipLevels = 1;
+					imageInfo.arrayLayers = 1;
+					imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+					imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+					imageInfo.usage = desc.usageFlags;
+					imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+					imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+					VkImage image;
+					if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+						throw std::runtime_error("Failed to create transient image " + desc.name);
+					objects.images.push_back(image);
+					desc.images = { image };
+
+					VkMemoryRequirements imageRequirements;
+					vkGetImageMemoryRequirements(device, image, &imageRequirements);
+					requirements.size = std::max(requirements.size, imageRequirements.size);
+					requirements.alignment = std::max(requirements.alignment, imageRequirements.alignment);
+					requirements.memoryTypeBits &= imageRequirements.memoryTypeBits;
+					members.push_back(resource);
+				}
+
+				if (requirements.memoryTypeBits == 0)
+					throw std::runtime_error("aliased transient images have no memory type in common");
+
+				Allocation allocation = allocator->allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+				objects.allocations.push_back(allocation);
+
+				for (Resource resource : members)
+				{
+					ResourceDesc& desc = resources[resource];
+					vkBindImageMemory(device, desc.images[0], allocation.memory, allocation.offset);
+
+					VkImageViewCreateInfo viewInfo = {};
+					viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+					viewInfo.image = desc.images[0];
+					viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+					viewInfo.format = desc.format;
+					viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+					VkImageView view;
+					if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+						throw std::runtime_error("Failed to create transient image view " + desc.name);
+					objects.imageViews.push_back(view);
+					desc.views = { view };
+				}
+			}
+		}
+
+		void BeRenderGraph::createRenderPasses()
+		{
+			for (auto& pass : passes)
+			{
+				pass.renderPass = VK_NULL_HANDLE;
+				if (!pass.raster || dynamicRendering)
+					continue;
+
+				// Layouts and synchronization are the graph's barriers around the pass, the pass itself only clears,
+				// loads and stores
+				std::vector<VkAttachmentDescription> attachments;
+				std::vector<VkAttachmentReference> references;
+				for (size_t i = 0; i < pass.colors.size(); i++)
+				{
+					VkAttachmentDescription attachment = {};
+					attachment.format = resources[pass.colors[i].resource].format;
+					attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+					attachment.loadOp = pass.loadOps[i];
+					attachment.storeOp = pass.storeOps[i];
+					attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+					attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+					attachments.push_back(attachment);
+					references.push_back({ static_cast<uint32_t>(i), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+				}
+
+				VkSubpassDescription subpass = {};
+				subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+				subpass.colorAttachmentCount = static_cast<uint32_t>(references.size());
+				subpass.pColorAttachments = references.data();
+
+				VkRenderPassCreateInfo renderPassInfo = {};
+				renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+				renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+				renderPassInfo.pAttachments = attachments.data();
+				renderPassInfo.subpassCount = 1;
+				renderPassInfo.pSubpasses = &subpass;
+
+				if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS)
+					throw std::runtime_error("failed to create render pass " + pass.name);
+				objects.renderPasses.push_back(pass.renderPass);
+			}
+		}
+
+		void BeRenderGraph::createFramebuffers()
+		{
+			for (auto& pass : passes)
+			{
+				if (!pass.raster || dynamicRendering)
+					continue;
+
+				// Imported attachments of one pass have to come in sets of the same size, one framebuffer per set
+				size_t framebufferCount = 1;
+				for (const auto& color : pass.colors)
+				{
+					const ResourceDesc& resource = resources[color.resource];
+					if (!resource.imported)
+						continue;
+					if (framebufferCount > 1 && resource.views.size() != framebufferCount)
+						throw std::runtime_error("imported attachments of render graph pass " + pass.name + " differ in image count");
+					framebufferCount = resource.views.size();
+				}
+
+				pass.framebuffers.resize(framebufferCount);
+				for (uint32_t i = 0; i < framebufferCount; i++)
+				{
+					std::vector<VkImageView> attachments;
+					for (const auto& color : pass.colors)
+						attachments.push_back(viewOf(color.resource, i));
+
+					VkFramebufferCreateInfo framebufferInfo = {};
+					framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+					framebufferInfo.renderPass = pass.renderPass;
+					framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+					framebufferInfo.pAttachments = attachments.data();
+					framebufferInfo.width = extent.width;
+					framebufferInfo.height = extent.height;
+					framebufferInfo.layers = 1;
+
+					if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &pass.framebuffers[i]) != VK_SUCCESS)
+						throw std::runtime_error("Failed to create framebuffer!");
+				}
+			}
+		}
+
+		void BeRenderGraph::releaseFramebuffers(RenderGraphObjects& out)
+		{
+			for (auto& pass : passes)
+			{
+				out.framebuffers.insert(out.framebuffers.end(), pass.framebuffers.begin(), pass.framebuffers.end());
+				pass.framebuffers.clear();
+			}
+		}
+
+		VkImage BeRenderGraph::imageOf(Resource resource, uint32_t imageIndex) const
+		{
+			const ResourceDesc& desc = resources[resource];
+			return desc.imported ? desc.images[imageIndex] : desc.images[0];
+		}
+
+		VkImageView BeRenderGraph::viewOf(Resource resource, uint32_t imageIndex) const
+		{
+			const ResourceDesc& desc = resources[resource];
+			return desc.imported ? desc.views[imageIndex] : desc.views[0];
+		}
+
+		void BeRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers, uint32_t imageIndex) const
+		{
+			if (barriers.empty())
+				return;
+
+			if (dynamicRendering)
+			{
+				// Every barrier keeps its own stages, the legacy flags used here have the same values in the 2 variants
+				std::vector<VkImageMemoryBarrier2> imageBarriers(barriers.size());
+				for (size_t i = 0; i < barriers.size(); i++)
+				{
+					const Barrier& barrier = barriers[i];
+					VkImageMemoryBarrier2& imageBarrier = imageBarriers[i];
+					imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+					imageBarrier.srcStageMask = barrier.srcStage;
+					imageBarrier.srcAccessMask = barrier.srcAccess;
+					imageBarrier.dstStageMask = barrier.dstStage == VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT ? VK_PIPELINE_STAGE_2_NONE : barrier.dstStage;
+					imageBarrier.dstAccessMask = barrier.dstAccess;
+					imageBarrier.oldLayout = barrier.oldLayout;
+					imageBarrier.newLayout = barrier.newLayout;
+					imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.image = imageOf(barrier.resource, imageIndex);
+					imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+				}
+
+				VkDependencyInfo dependencyInfo = {};
+				dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+				dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+				dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+				vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+				return;
+			}
+
+			std::vector<VkImageMemoryBarrier> imageBarriers(barriers.size());
+			VkPipelineStageFlags srcStages = 0;
+			VkPipelineStageFlags dstStages = 0;
+			for (size_t i = 0; i < barriers.size(); i++)
+			{
+				const Barrier& barrier = barriers[i];
+				VkImageMemoryBarrier& imageBarrier = imageBarriers[i];
+				imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				imageBarrier.srcAccessMask = barrier.srcAccess;
+				imageBarrier.dstAccessMask = barrier.dstAccess;
+				imageBarrier.oldLayout = barrier.oldLayout;
+				imageBarrier.newLayout = barrier.newLayout;
+				imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				imageBarrier.image = imageOf(barrier.resource, imageIndex);
+				imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+				srcStages |= barrier.srcStage;
+				dstStages |= barrier.dstStage;
+			}
+
+			// Nothing earlier to wait for, e.g. a transient whose memory no pass has touched yet
+			if (srcStages == 0)
+				srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+		}
+
+		void BeRenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t imageIndex) const
+		{
+			for (Pass index : order)
+			{
+				const PassDesc& pass = passes[index];
+				recordBarriers(commandBuffer, pass.barriers, imageIndex);
+
+				PassContext context = { pass.renderPass, VK_NULL_HANDLE, extent, imageIndex };
+				if (!pass.raster)
+				{
+					pass.record(commandBuffer, context);
+					continue;
+				}
+
+				if (dynamicRendering)
+				{
+					std::vector<VkRenderingAttachmentInfo> attachments(pass.colors.size());
+					for (size_t i = 0; i < pass.colors.size(); i++)
+					{
+						attachments[i].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+						attachments[i].imageView = viewOf(pass.colors[i].resource, imageIndex);
+						attachments[i].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+						attachments[i].loadOp = pass.loadOps[i];
+						attachments[i].storeOp = pass.storeOps[i];
+						attachments[i].clearValue.color = pass.colors[i].clearValue;
+					}
+
+					VkRenderingInfo renderingInfo = {};
+					renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+					renderingInfo.flags = pass.secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+					renderingInfo.renderArea.offset = { 0, 0 };
+					renderingInfo.renderArea.extent = extent;
+					renderingInfo.layerCount = 1;
+					renderingInfo.colorAttachmentCount = static_cast<uint32_t>(attachments.size());
+					renderingInfo.pColorAttachments = attachments.data();
+
+					vkCmdBeginRendering(commandBuffer, &renderingInfo);
+					pass.record(commandBuffer, context);
+					vkCmdEndRendering(commandBuffer);
+					continue;
+				}
+
+				context.framebuffer = pass.framebuffers.size() > 1 ? pass.framebuffers[imageIndex] : pass.framebuffers[0];
+
+				std::vector<VkClearValue> clearValues(pass.colors.size());
+				for (size_t i = 0; i < pass.colors.size(); i++)
+					clearValues[i].color = pass.colors[i].clearValue;
+
+				VkRenderPassBeginInfo renderPassInfo = {};
+				renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				renderPassInfo.renderPass = pass.renderPass;
+				renderPassInfo.framebuffer = context.framebuffer;
+				renderPassInfo.renderArea.offset = { 0, 0 };
+				renderPassInfo.renderArea.extent = extent;
+				renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+				renderPassInfo.pClearValues = clearValues.data();
+
+				vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, pass.secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+				pass.record(commandBuffer, context);
+				vkCmdEndRenderPass(commandBuffer);
+			}
+
+			recordBarriers(commandBuffer, finalBarriers, imageIndex);
+		}
+	}
+}
\ No newline at end of file
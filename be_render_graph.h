@@ -0,0 +1,187 @@
+#pragma once
+
+#include "be_allocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace be
+{
+	namespace renderer {
+
+		// What a pass does with an image, decides the layout it needs and what barriers around it wait for
+		enum class ImageUsage
+		{
+			ColorAttachment,
+			Sampled,
+			TransferSrc,
+			TransferDst,
+			Present
+		};
+
+		// Vulkan objects of a compiled graph. Rebuilds hand the replaced ones out instead of destroying them, so they can
+		// wait for the frames still using them.
+		struct RenderGraphObjects
+		{
+			::std::vector<VkRenderPass> renderPasses;
+			::std::vector<VkFramebuffer> framebuffers;
+			::std::vector<VkImageView> imageViews;
+			::std::vector<VkImage> images;
+			::std::vector<Allocation> allocations;
+		};
+
+		// Passes declare the images they read and write. compile() orders the passes, plans every layout transition
+		// and barrier between them and lets transient images whose lifetimes don't overlap share memory. Imported
+		// images (the swapchain) are owned elsewhere and can be swapped without planning again.
+		class BeRenderGraph
+		{
+		public:
+			using Resource = uint32_t;
+			using Pass = uint32_t;
+
+			struct ImageAccess
+			{
+				Resource resource;
+				ImageUsage usage;
+			};
+
+			struct ColorAttachment
+			{
+				Resource resource;
+				// Attachments that aren't cleared keep what earlier passes wrote
+				bool clear = false;
+				VkClearColorValue clearValue = {};
+			};
+
+			struct PassContext
+			{
+				// Null for passes outside a render pass and with dynamic rendering
+				VkRenderPass renderPass;
+				VkFramebuffer framebuffer;
+				VkExtent2D extent;
+				uint32_t imageIndex;
+			};
+
+			using RecordFn = ::std::function<void(VkCommandBuffer commandBuffer, const PassContext& context)>;
+
+			void init(VkDevice device, BeAllocator* allocator);
+			void destroy();
+
+			// Raster passes use vkCmdBeginRendering and synchronization2 barriers instead of render pass and
+			// framebuffer objects. Needs both Vulkan 1.3 features, takes effect on the next compile.
+			void setDynamicRendering(bool enabled);
+			bool usesDynamicRendering() const { return dynamicRendering; }
+
+			// An image owned outside the graph. Its first use in a frame waits on waitStage, e.g. the stage the acquire
+			// semaphore is waited on, and every frame leaves it in the layout of finalUsage.
+			Resource importImage(const char* name, VkFormat format, VkPipelineStageFlags waitStage, ImageUsage finalUsage);
+			// What the imported image stands for, indexed by the imageIndex given to execute
+			void setImportedImages(Resource resource, const ::std::vector<VkImage>& images, const ::std::vector<VkImageView>& views);
+			// An image at the graph's extent whose contents only live from its first to its last use within a frame
+			Resource createTransient(const char* name, VkFormat format);
+
+			// Records inside a render pass over colors. secondary passes only execute secondary command buffers.
+			Pass addRasterPass(const char* name, const ::std::vector<ColorAttachment>& colors, const ::std::vector<ImageAccess>& reads, bool secondary, RecordFn record);
+			// Records outside of any render pass, e.g. copies and blits
+			Pass addPass(const char* name, const ::std::vector<ImageAccess>& accesses, RecordFn record);
+
+			// Plans again and recreates everything when passes were added or the extent changed, only the framebuffers
+			// when just the imported images changed, nothing otherwise. Replaced objects go to retired when given,
+			// otherwise they are destroyed right away and must not be in use.
+			void compile(VkExtent2D extent, RenderGraphObjects* retired = nullptr);
+			void destroyObjects(RenderGraphObjects& objects);
+
+			// Records every pass in order with the planned barriers in between
+			void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
+
+			VkRenderPass getRenderPass(Pass pass) const { return passes[pass].renderPass; }
+			// What resource stands for in the frame recorded for imageIndex
+			VkImage getImage(Resource resource, uint32_t imageIndex) const { return imageOf(resource, imageIndex); }
+			// What pipelines and secondary command buffers rendering in the pass declare with dynamic rendering
+			::std::vector<VkFormat> getColorFormats(Pass pass) const;
+			const ::std::vector<Pass>& getOrder() const { return order; }
+			// Memory blocks backing the transient images, fewer than transients when some alias
+			uint32_t getTransientMemoryBlocks() const { return aliasGroupCount; }
+
+		private:
+			struct ResourceDesc
+			{
+				::std::string name;
+				VkFormat format = VK_FORMAT_UNDEFINED;
+				bool imported = false;
+				VkPipelineStageFlags waitStage = 0;
+				ImageUsage finalUsage = ImageUsage::Present;
+				::std::vector<VkImage> images;
+				::std::vector<VkImageView> views;
+
+				// Planned
+				VkImageUsageFlags usageFlags = 0;
+				uint32_t firstUse = UINT32_MAX;
+				uint32_t lastUse = 0;
+				uint32_t aliasGroup = 0;
+			};
+
+			struct Barrier
+			{
+				Resource resource;
+				VkImageLayout oldLayout;
+				VkImageLayout newLayout;
+				VkPipelineStageFlags srcStage;
+				VkPipelineStageFlags dstStage;
+				VkAccessFlags srcAccess;
+				VkAccessFlags dstAccess;
+			};
+
+			struct PassDesc
+			{
+				::std::string name;
+				bool raster = false;
+				bool secondary = false;
+				::std::vector<ColorAttachment> colors;
+				// Every image the pass touches, color attachments included
+				::std::vector<ImageAccess> accesses;
+				RecordFn record;
+
+				// Planned
+				::std::vector<Barrier> barriers;
+				::std::vector<VkAttachmentLoadOp> loadOps;
+				::std::vector<VkAttachmentStoreOp> storeOps;
+				VkRenderPass renderPass = VK_NULL_HANDLE;
+				// One per imported image when an attachment is imported, one otherwise, none with dynamic rendering
+				::std::vector<VkFramebuffer> framebuffers;
+			};
+
+			void sortPasses();
+			void planBarriers();
+			void planAliasing();
+			void createTransients();
+			void createRenderPasses();
+			void createFramebuffers();
+			void recordBarriers(VkCommandBuffer commandBuffer, const ::std::vector<Barrier>& barriers, uint32_t imageIndex) const;
+			VkImage imageOf(Resource resource, uint32_t imageIndex) const;
+			VkImageView viewOf(Resource resource, uint32_t imageIndex) const;
+			void releaseFramebuffers(RenderGraphObjects& out);
+
+			VkDevice device = VK_NULL_HANDLE;
+			BeAllocator* allocator = nullptr;
+
+			::std::vector<ResourceDesc> resources;
+			::std::vector<PassDesc> passes;
+			::std::vector<Pass> order;
+			// Leaves imported images in their final layout
+			::std::vector<Barrier> finalBarriers;
+			uint32_t aliasGroupCount = 0;
+
+			bool declarationsChanged = true;
+			bool importsChanged = true;
+			bool compiled = false;
+			bool dynamicRendering = false;
+			VkExtent2D extent = {};
+			// Everything but the framebuffers, those live in their passes
+			RenderGraphObjects objects;
+		};
+	}
+}
\ No newline at end of file
@@ -1,11 +1,15 @@
 #include "be_renderer.h"
 
 #include <iostream>
+#include <fstream>
 #include <stdexcept>
 #include <map>
 #include <set>
 
+#include <chrono>
 #include <cstdint>
+#include <future>
+#include <cstring>
 #include <limits>
 #include <algorithm>
 
@@ -14,11 +18,75 @@
 namespace be {
 	namespace renderer {
 
+		struct LatencySettings
+		{
+			uint32_t framesInFlight;
+			// Swapchain images asked for on top of the surface's minimum
+			uint32_t extraImages;
+			// In order of preference, FIFO is always supported and ends every list
+			::std::vector<VkPresentModeKHR> presentModes;
+		};
+
+		static LatencySettings latencySettings(LatencyMode mode)
+		{
+			switch (mode)
+			{
+			case LatencyMode::LowLatency:
+				return { 1, 0, { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR } };
+			case LatencyMode::Throughput:
+				return { 3, 2, { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR } };
+			default:
+				return { 2, 1, { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR } };
+			}
+		}
+
+		static const char* presentModeName(VkPresentModeKHR mode)
+		{
+			switch (mode)
+			{
+			case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+			case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+			case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo relaxed";
+			default: return "fifo";
+			}
+		}
+
+		// What secondary buffers continuing a dynamic rendering pass over these formats inherit
+		static VkCommandBufferInheritanceRenderingInfo inheritedRendering(const std::vector<VkFormat>& colorFormats)
+		{
+			VkCommandBufferInheritanceRenderingInfo renderingInfo = {};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+			renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+			renderingInfo.pColorAttachmentFormats = colorFormats.data();
+			renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			return renderingInfo;
+		}
+
+		const char* latencyModeName(LatencyMode mode)
+		{
+			switch (mode)
+			{
+			case LatencyMode::LowLatency: return "low";
+			case LatencyMode::Throughput: return "throughput";
+			default: return "balanced";
+			}
+		}
+
 		BeRenderer::~BeRenderer()
 		{
 			terminateVk();
 		}
 
+		// Times one step of init into stages, relative to origin
+		template <typename Fn>
+		static void timeStage(std::vector<StartupStage>& stages, std::chrono::steady_clock::time_point origin, const char* name, bool worker, Fn&& fn)
+		{
+			auto start = std::chrono::steady_clock::now();
+			fn();
+			auto end = std::chrono::steady_clock::now();
+			stages.push_back({ name, std::chrono::duration<double, std::milli>(start - origin).count(), std::chrono::duration<double, std::milli>(end - start).count(), worker });
+		}
+
 		bool BeRenderer::init()
 		{
 			if (enableValidationLayers && !checkValidationLayerSupport())
@@ -26,6 +94,124 @@ namespace be {
 				throw std::runtime_error("Validation layers not supported!!");
 			}
 
+			startupOrigin = std::chrono::steady_clock::now();
+			startupStages.clear();
+			firstPresentMs = -1.0;
+
+			// Shader and pipeline work runs on a worker as soon as what it needs exists: file reads right away, shader
+			// modules and the pipeline cache once there is a device, the pipeline once the render graph knows the
+			// attachment formats. The main thread meanwhile builds the swapchain, buffers and per frame objects.
+			std::promise<void> deviceReady;
+			std::promise<void> graphReady;
+			std::shared_future<void> deviceFuture = deviceReady.get_future().share();
+			std::shared_future<void> graphFuture = graphReady.get_future().share();
+			bool deviceSignaled = false;
+			bool graphSignaled = false;
+
+			std::vector<StartupStage> workerStages;
+			std::future<void> pipelineJob = std::async(std::launch::async, [this, &workerStages, deviceFuture, graphFuture]() {
+				std::vector<char> cacheData;
+				timeStage(workerStages, startupOrigin, "asset pack and pipeline cache file", true, [&]() {
+					assets.open(getExecutableDir() + "assets.pack");
+
+					std::ifstream file(getExecutableDir() + "pipeline_cache.bin", std::ios::ate | std::ios::binary);
+					if (file.is_open())
+					{
+						cacheData.resize(static_cast<size_t>(file.tellg()));
+						file.seekg(0);
+						file.read(cacheData.data(), cacheData.size());
+					}
+				});
+
+				deviceFuture.get();
+				timeStage(workerStages, startupOrigin, "shader modules", true, [this]() { createShaderModules(); });
+				timeStage(workerStages, startupOrigin, "pipeline cache", true, [this, &cacheData]() { createPipelineCache(cacheData); });
+
+				graphFuture.get();
+				timeStage(workerStages, startupOrigin, pipelineCacheWarm ? "graphics pipeline (warm cache)" : "graphics pipeline (cold cache)", true, [this]() { createGraphicsPipeline(); });
+			});
+
+			try
+			{
+				timeStage(startupStages, startupOrigin, "instance", false, [this]() { createInstance(); });
+
+				framesInFlight = latencySettings(latencyMode).framesInFlight;
+
+				timeStage(startupStages, startupOrigin, "surface and physical device", false, [this]() {
+					if (!headless)
+						createSurface();
+
+					getVkPhysicalDevice();
+				});
+
+				timeStage(startupStages, startupOrigin, "logical device", false, [this]() { createLogicDevice(); });
+				deviceReady.set_value();
+				deviceSignaled = true;
+
+				timeStage(startupStages, startupOrigin, "swapchain and render graph", false, [this]() {
+					allocator.init(vkPhysicalDevice, vkDevice);
+
+					createSwapChain();
+
+					createImageViews();
+
+					if (isCapturing())
+					{
+						capture.init(vkDevice, &allocator, captureSink, captureLossless);
+						capture.resize(framesInFlight, swapChainExtent, swapChainImageFormat);
+					}
+
+					createRenderGraph();
+				});
+				graphReady.set_value();
+				graphSignaled = true;
+
+				timeStage(startupStages, startupOrigin, "buffers and uploads", false, [this]() {
+					createCommandTool();
+
+					QueueFamilyIndices indices = findQueueFamilies(vkPhysicalDevice);
+					staging.init(vkDevice, &allocator, transferQueue, indices.transferFamily.value_or(indices.graphicsFamily.value()), indices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT);
+
+					createVertexBuffer();
+
+					createIndexBuffer();
+
+					createInstanceBuffers();
+				});
+
+				timeStage(startupStages, startupOrigin, "command buffers, sync and profiler", false, [this]() {
+					createCommandBuffer();
+
+					createSyncObjects();
+
+					QueueFamilyIndices indices = findQueueFamilies(vkPhysicalDevice);
+					profiler.init(vkPhysicalDevice, vkDevice, indices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, capabilities.pipelineStatistics);
+				});
+
+				timeStage(startupStages, startupOrigin, "wait for pipeline", false, [&pipelineJob]() { pipelineJob.get(); });
+			}
+			catch (...)
+			{
+				// Unblock the worker before leaving, it can't outlive init
+				if (!deviceSignaled)
+					deviceReady.set_exception(std::current_exception());
+				if (!graphSignaled)
+					graphReady.set_exception(std::current_exception());
+				if (pipelineJob.valid())
+					pipelineJob.wait();
+				throw;
+			}
+
+			startupStages.insert(startupStages.end(), workerStages.begin(), workerStages.end());
+			std::sort(startupStages.begin(), startupStages.end(), [](const StartupStage& a, const StartupStage& b) { return a.startMs < b.startMs; });
+			startupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupOrigin).count();
+			dumpStartup(std::cout);
+
+			return true;
+		}
+
+		void BeRenderer::createInstance()
+		{
 			VkApplicationInfo appInfo = {};
 			appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 			appInfo.pApplicationName = "VkPong";
@@ -34,7 +220,10 @@ namespace be {
 			appInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
 			appInfo.apiVersion = VK_API_VERSION_1_3;
 
-			auto requiredExtensions = getRequiredExtensions();
+			// Presentation and validation are the only instance extensions the renderer uses
+			capabilityRequest.presentation = !headless;
+			capabilityRequest.debugUtils = enableValidationLayers;
+			auto requiredExtensions = negotiateInstanceExtensions(capabilityRequest, capabilities);
 
 			VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
 			debugCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -68,36 +257,18 @@ namespace be {
 			}
 
 			setupDebugMessenger(debugCreateInfo);
+		}
 
-			createSurface();
-
-			getVkPhysicalDevice();
-
-			createLogicDevice();
-
-			createSwapChain();
-
-			createImageViews();
-
-			createRenderPass();
-
-			createGraphicsPipeline();
-
-			createFramebuffers();
-
-			createCommandTool();
-
-			createVertexBuffer();
-
-			createCommandBuffer();
-
-			createSyncObjects();
-
-			return true;
+		void BeRenderer::dumpStartup(std::ostream& out) const
+		{
+			out << "startup: ready after " << startupMs << " ms" << std::endl;
+			for (const auto& stage : startupStages)
+				out << "  " << (stage.worker ? "worker" : "main  ") << " at " << stage.startMs << " ms: " << stage.name << " " << stage.durationMs << " ms" << std::endl;
 		}
 
 		void BeRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 		{
+			// Everything recorded here is replayed until invalidated, per frame data is read from buffers
 			VkCommandBufferBeginInfo beginInfo = {};
 			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 			beginInfo.flags = 0;
@@ -106,21 +277,32 @@ namespace be {
 			if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
 				throw std::runtime_error("Failed to begin recording command buffer");
 
-			VkRenderPassBeginInfo renderPassInfo = {};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = vkRenderPass;
-			renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = swapChainExtent;
+			profiler.cmdBeginFrame(commandBuffer, currentFrame);
+			// Timestamps can't be written inside a render pass that only executes secondary buffers, there the whole
+			// graph is one draw scope. Inline recording times the draw itself.
+			if (recordThreads > 0)
+				profiler.cmdBeginDraw(commandBuffer, currentFrame);
 
-			VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
-			renderPassInfo.clearValueCount = 1;
-			renderPassInfo.pClearValues = &clearColor;
+			graph.execute(commandBuffer, imageIndex);
 
-			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-				
+			if (recordThreads > 0)
+				profiler.cmdEndDraw(commandBuffer, currentFrame);
+			profiler.cmdEndFrame(commandBuffer, currentFrame);
+
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+				throw std::runtime_error("Failed to end command buffer");
+		}
+
+		void BeRenderer::recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t firstDraw, uint32_t drawCount)
+		{
+			// Secondary buffers inherit no state, so every range binds everything it uses
 			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkGraphicsPipeline);
 
+			VkBuffer vertexBuffers[] = { vertexBuffer, instanceBuffers[frameIndex] };
+			VkDeviceSize offsets[] = { 0, 0 };
+			vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
 			VkViewport viewport = {};
 			viewport.x = 0.0f;
 			viewport.y = 0.0f;
@@ -135,52 +317,207 @@ namespace be {
 			scissor.extent = swapChainExtent;
 			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-			vkCmdDraw(commandBuffer, 3, 1, 0, 0);	
+			// Instance counts live in the indirect buffer, ranges past the end of the batch have zero instances
+			for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++)
+				vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffers[frameIndex], i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
 
-			vkCmdEndRenderPass(commandBuffer);
+		double BeRenderer::benchmarkRecording(uint32_t drawCount, uint32_t threadCount, uint32_t iterations)
+		{
+			// Same state and draw pattern as a frame, recorded into a throwaway slot that is never submitted
+			QueueFamilyIndices queueFamilies = findQueueFamilies(vkPhysicalDevice);
+
+			// A job system of its own, so the thread count doesn't depend on the one the frames use
+			BeJobSystem benchJobs;
+			benchJobs.init(threadCount);
+
+			BeParallelRecorder bench;
+			bench.init(vkDevice, queueFamilies.graphicsFamily.value(), &benchJobs, threadCount, 1);
+
+			VkCommandBufferInheritanceInfo inheritance = {};
+			inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritance.renderPass = graph.getRenderPass(scenePass);
+			inheritance.subpass = 0;
+			inheritance.framebuffer = VK_NULL_HANDLE;
+
+			std::vector<VkFormat> colorFormats = graph.getColorFormats(scenePass);
+			VkCommandBufferInheritanceRenderingInfo renderingInfo = inheritedRendering(colorFormats);
+			if (graph.usesDynamicRendering())
+				inheritance.pNext = &renderingInfo;
+
+			auto recordRange = [this](VkCommandBuffer commandBuffer, uint32_t first, uint32_t count) {
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkGraphicsPipeline);
+
+				VkBuffer vertexBuffers[] = { vertexBuffer, instanceBuffers[0] };
+				VkDeviceSize offsets[] = { 0, 0 };
+				vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+				vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+				VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), 0.0f, 1.0f };
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				VkRect2D scissor = { { 0, 0 }, swapChainExtent };
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+				for (uint32_t i = first; i < first + count; i++)
+					vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, i);
+			};
 
-			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-				throw std::runtime_error("Failed to end command buffer");
+			double totalMs = 0.0;
+			try
+			{
+				for (uint32_t i = 0; i < iterations; i++)
+				{
+					auto start = std::chrono::steady_clock::now();
+					bench.record(0, inheritance, drawCount, recordRange);
+					totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				}
+			}
+			catch (...)
+			{
+				bench.destroy();
+				throw;
+			}
+
+			bench.destroy();
+			return iterations > 0 ? totalMs / iterations : 0.0;
 		}
 
-		void BeRenderer::drawFrame()
+		uint32_t BeRenderer::gatherCommandBuffers(uint32_t imageIndex, VkCommandBuffer* out)
 		{
-			vkWaitForFences(vkDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+			uint32_t count = 0;
+
+			// Ownership acquires depend on what was uploaded this frame, so they get their own short buffer
+			if (staging.hasPendingAcquire(currentFrame))
+			{
+				VkCommandBuffer acquire = acquireCommandBuffers[currentFrame];
+				vkResetCommandBuffer(acquire, 0);
+
+				VkCommandBufferBeginInfo beginInfo = {};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+				if (vkBeginCommandBuffer(acquire, &beginInfo) != VK_SUCCESS)
+					throw std::runtime_error("Failed to begin recording command buffer");
+				staging.cmdAcquire(acquire, currentFrame);
+				if (vkEndCommandBuffer(acquire) != VK_SUCCESS)
+					throw std::runtime_error("Failed to end command buffer");
+
+				out[count++] = acquire;
+			}
+
+			CachedCommandBuffer& cached = cachedCommandBuffers[currentFrame * swapChainImages.size() + imageIndex];
+			if (cached.dirty)
+			{
+				vkResetCommandBuffer(cached.commandBuffer, 0);
+				recordCommandBuffer(cached.commandBuffer, imageIndex);
+				cached.drawScopes = profiler.recordedDrawScopes(currentFrame);
+				cached.dirty = false;
+				recordedCommandBuffers++;
+			}
+			else
+				profiler.replayFrame(currentFrame, cached.drawScopes);
+
+			out[count++] = cached.commandBuffer;
+			return count;
+		}
+
+		void BeRenderer::collectPresentTimes()
+		{
+			// Polled once per frame without blocking, so a display time is late by at most the time between two frames
+			while (!pendingPresents.empty())
+			{
+				VkResult result = vkWaitForPresent(vkDevice, swapChain, pendingPresents.front().presentId, 0);
+				if (result == VK_TIMEOUT)
+				{
+					// Nothing is shown while minimized, don't let the queue grow without bound
+					if (pendingPresents.size() < MAX_PENDING_PRESENTS)
+						break;
+				}
+				else if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+					displayLatency.addSince(pendingPresents.front().input);
+
+				pendingPresents.pop_front();
+			}
+		}
+
+		void BeRenderer::invalidateCommandBuffers(uint32_t frameIndex)
+		{
+			size_t imageCount = swapChainImages.size();
+			for (size_t i = 0; i < imageCount && frameIndex * imageCount + i < cachedCommandBuffers.size(); i++)
+				cachedCommandBuffers[frameIndex * imageCount + i].dirty = true;
+		}
+
+		void BeRenderer::drawFrame(InputTimestamp input)
+		{
+			waitForFrame();
+			destroyRetired(completedFrames);
+			collectPresentTimes();
+			if (isCapturing())
+				capture.collect(completedFrames);
+
+			profiler.beginFrame(currentFrame);
+			staging.beginFrame(currentFrame);
+
+			VkCommandBuffer submitBuffers[2];
+
+			if (headless)
+			{
+				uint32_t imageIndex = headlessImageIndex;
+				headlessImageIndex = (headlessImageIndex + 1) % static_cast<uint32_t>(swapChainImages.size());
+
+				VkSemaphore uploadSemaphore = staging.flush(currentFrame);
+				VkPipelineStageFlags uploadStage = BeStagingRing::CONSUMER_STAGES;
+
+				updateInstanceBuffer(currentFrame);
+
+				VkSubmitInfo submitInfo = {};
+				submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+				submitInfo.waitSemaphoreCount = uploadSemaphore != VK_NULL_HANDLE ? 1 : 0;
+				submitInfo.pWaitSemaphores = &uploadSemaphore;
+				submitInfo.pWaitDstStageMask = &uploadStage;
+				submitInfo.commandBufferCount = gatherCommandBuffers(imageIndex, submitBuffers);
+				submitInfo.pCommandBuffers = submitBuffers;
+
+				submitFrame(submitInfo);
+				recordFirstPresent();
+
+				currentFrame = (currentFrame + 1) % framesInFlight;
+				return;
+			}
 
 			uint32_t imageIndex;
 			VkResult result = vkAcquireNextImageKHR(vkDevice, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
-			if (result == VK_ERROR_OUT_OF_DATE_KHR || ::g_resized)
+			// Only a swapchain that can't be presented to anymore drops the frame. A resize or a suboptimal image is
+			// handled after the present, an acquired image has to be presented or its semaphore stays signaled.
+			if (result == VK_ERROR_OUT_OF_DATE_KHR)
 			{
-				::g_resized = false;
 				recreateSwapChain();
 				return;
 			}
 			else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
 				throw std::runtime_error("failed to acquire swap chain image!");
 
-			vkResetFences(vkDevice, 1, &inFlightFences[currentFrame]);
+			VkSemaphore uploadSemaphore = staging.flush(currentFrame);
 
-			vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-			recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+			updateInstanceBuffer(currentFrame);
 
 			VkSubmitInfo submitInfo = {};;
 			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-			VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame]};
-			VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-			submitInfo.waitSemaphoreCount = 1;
+			VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame], uploadSemaphore };
+			VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, BeStagingRing::CONSUMER_STAGES };
+			submitInfo.waitSemaphoreCount = uploadSemaphore != VK_NULL_HANDLE ? 2 : 1;
 			submitInfo.pWaitSemaphores = waitSemaphores;
 			submitInfo.pWaitDstStageMask = waitStages;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+			submitInfo.commandBufferCount = gatherCommandBuffers(imageIndex, submitBuffers);
+			submitInfo.pCommandBuffers = submitBuffers;
 
 			VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame]};
 			submitInfo.signalSemaphoreCount = 1;
 			submitInfo.pSignalSemaphores = signalSemaphores;
 
-			if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
-				throw std::runtime_error("failed to submit draw command buffer!");
+			submitFrame(submitInfo);
 
 			VkPresentInfoKHR presentInfo = {};
 			presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -193,17 +530,210 @@ namespace be {
 			presentInfo.pImageIndices = &imageIndex;
 			presentInfo.pResults = nullptr;
 
+			uint64_t presentId = nextPresentId++;
+			VkPresentIdKHR presentIdInfo = {};
+			if (capabilities.presentWait)
+			{
+				presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+				presentIdInfo.swapchainCount = 1;
+				presentIdInfo.pPresentIds = &presentId;
+				presentInfo.pNext = &presentIdInfo;
+			}
+
 			result = vkQueuePresentKHR(presentQueue, &presentInfo);
+			recordFirstPresent();
 
-			if (result == VK_ERROR_OUT_OF_DATE_KHR || ::g_resized)
+			if (input != 0)
+			{
+				presentLatency.addSince(input);
+				if (capabilities.presentWait)
+					pendingPresents.push_back({ presentId, input });
+			}
+
+			if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || ::g_resized)
 			{
 				::g_resized = false;
 				recreateSwapChain();
 			}
 			else if (result != VK_SUCCESS)
-				throw std::runtime_error("failed to acquire swap chain image!");
+				throw std::runtime_error("failed to present swap chain image!");
+
+			currentFrame = (currentFrame + 1) % framesInFlight;
+		}
+
+		void BeRenderer::submitFrame(VkSubmitInfo& submitInfo)
+		{
+			uint64_t frame = submittedFrames + 1;
+
+			// The timeline is signaled next to the binary semaphore the present waits on, if any. Binary semaphores
+			// ignore their value.
+			VkSemaphore signalSemaphores[] = { frameTimeline, VK_NULL_HANDLE };
+			uint64_t signalValues[] = { frame, 0 };
+			VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+			VkFence fence = VK_NULL_HANDLE;
+
+			if (capabilities.timelineSemaphore)
+			{
+				if (submitInfo.signalSemaphoreCount > 0)
+					signalSemaphores[1] = submitInfo.pSignalSemaphores[0];
+
+				timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+				timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount + 1;
+				timelineInfo.pSignalSemaphoreValues = signalValues;
+
+				submitInfo.pNext = &timelineInfo;
+				submitInfo.signalSemaphoreCount++;
+				submitInfo.pSignalSemaphores = signalSemaphores;
+			}
+			else
+			{
+				fence = inFlightFences[currentFrame];
+				vkResetFences(vkDevice, 1, &fence);
+			}
+
+			if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence) != VK_SUCCESS)
+				throw std::runtime_error("failed to submit draw command buffer!");
+			frameNumbers[currentFrame] = submittedFrames = frame;
+			if (isCapturing())
+				capture.submitted(currentFrame, frame);
+		}
+
+		void BeRenderer::recordFirstPresent()
+		{
+			if (firstPresentMs >= 0.0)
+				return;
+
+			// Headless frames count once submitted, there is nothing to present them to
+			firstPresentMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupOrigin).count();
+			std::cout << "startup: first frame " << (headless ? "submitted" : "presented") << " after " << firstPresentMs << " ms" << std::endl;
+		}
+
+		void BeRenderer::waitForFrame()
+		{
+			// The frame that last used this slot
+			waitForFrameNumber(frameNumbers[currentFrame]);
+		}
+
+		void BeRenderer::waitForFrameNumber(uint64_t frame)
+		{
+			if (frame <= completedFrames)
+				return;
+			if (frame > submittedFrames)
+				throw std::runtime_error("waiting for a frame that hasn't been submitted");
+
+			if (capabilities.timelineSemaphore)
+			{
+				VkSemaphoreWaitInfo waitInfo = {};
+				waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+				waitInfo.semaphoreCount = 1;
+				waitInfo.pSemaphores = &frameTimeline;
+				waitInfo.pValues = &frame;
+				vkWaitSemaphores(vkDevice, &waitInfo, UINT64_MAX);
+
+				// Later frames may have finished too
+				uint64_t value = frame;
+				vkGetSemaphoreCounterValue(vkDevice, frameTimeline, &value);
+				completedFrames = std::max(completedFrames, value);
+				return;
+			}
+
+			// One queue, so frames complete in submit order and the oldest slot holding frame or a later one covers it
+			uint32_t slot = 0;
+			for (uint32_t i = 1; i < framesInFlight; i++)
+			{
+				if (frameNumbers[i] >= frame && (frameNumbers[slot] < frame || frameNumbers[i] < frameNumbers[slot]))
+					slot = i;
+			}
+
+			vkWaitForFences(vkDevice, 1, &inFlightFences[slot], VK_TRUE, UINT64_MAX);
+			completedFrames = std::max(completedFrames, frameNumbers[slot]);
+		}
+
+		bool BeRenderer::isFrameComplete(uint64_t frame)
+		{
+			if (frame <= completedFrames)
+				return true;
+
+			if (capabilities.timelineSemaphore)
+			{
+				uint64_t value = 0;
+				if (vkGetSemaphoreCounterValue(vkDevice, frameTimeline, &value) == VK_SUCCESS)
+					completedFrames = std::max(completedFrames, value);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < framesInFlight; i++)
+				{
+					if (frameNumbers[i] > completedFrames && vkGetFenceStatus(vkDevice, inFlightFences[i]) == VK_SUCCESS)
+						completedFrames = std::max(completedFrames, frameNumbers[i]);
+				}
+			}
+
+			return frame <= completedFrames;
+		}
+
+		void BeRenderer::setLatencyMode(LatencyMode mode)
+		{
+			latencyMode = mode;
+			if (vkDevice == VK_NULL_HANDLE)
+				return;
+
+			vkDeviceWaitIdle(vkDevice);
+
+			// Slots past the new frame count would only be resolved once a later switch brings them back, late and
+			// out of order
+			profiler.resolvePending();
+
+			// Every per frame object is idle now, so they can be resized and the rotation restarted from slot 0
+			framesInFlight = latencySettings(mode).framesInFlight;
+			currentFrame = 0;
+
+			destroySyncObjects();
+			createSyncObjects();
+
+			vkFreeCommandBuffers(vkDevice, commandPool, static_cast<uint32_t>(acquireCommandBuffers.size()), acquireCommandBuffers.data());
+			createAcquireCommandBuffers();
+			resizeInstanceBuffers(framesInFlight);
 
-			currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+			// Also rebuilds the cached command buffers and the recorder slots for the new frame count. The device is
+			// idle, so what the rebuild retired can go right away.
+			recreateSwapChain();
+			completedFrames = submittedFrames;
+			destroyRetired(UINT64_MAX);
+		}
+
+		void BeRenderer::waitIdle()
+		{
+			if (vkDevice == VK_NULL_HANDLE)
+				return;
+
+			vkDeviceWaitIdle(vkDevice);
+			// Every submitted frame is done, captures shouldn't wait for frames that may never come
+			if (isCapturing())
+				capture.collect(submittedFrames);
+		}
+
+		void BeRenderer::getDeviceLocalBudget(VkDeviceSize& usage, VkDeviceSize& budget) const
+		{
+			usage = 0;
+			budget = 0;
+			if (!capabilities.memoryBudget)
+				return;
+
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+			budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+			VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+			memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			memoryProperties.pNext = &budgetProperties;
+			vkGetPhysicalDeviceMemoryProperties2(vkPhysicalDevice, &memoryProperties);
+
+			for (uint32_t i = 0; i < memoryProperties.memoryProperties.memoryHeapCount; i++)
+			{
+				if ((memoryProperties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0)
+					continue;
+				usage += budgetProperties.heapUsage[i];
+				budget += budgetProperties.heapBudget[i];
+			}
 		}
 
 		void BeRenderer::setupDebugMessenger(const VkDebugUtilsMessengerCreateInfoEXT& createInfo)
@@ -260,7 +790,7 @@ namespace be {
 			else if (deviceProps.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
 				score += 500;
 			else if (deviceProps.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)
-				score += 250;
+				score += softwareRendering ? 100000 : 250;
 
 			score += deviceProps.limits.maxImageDimension2D;
 
@@ -271,10 +801,12 @@ namespace be {
 			if (!indices.isComplete())
 				return 0;
 
-			auto extensionsSupported = checkDeviceExtensionSupport(device);
-			if (!extensionsSupported)
+			if (!hasDeviceExtensions(device, requiredDeviceExtensions(capabilityRequest)))
 				return 0;
 
+			if (headless)
+				return score;
+
 			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 			if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty())
 				return 0;
@@ -288,6 +820,8 @@ namespace be {
 
 			std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 			std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+			if (indices.transferFamily.has_value())
+				uniqueQueueFamilies.insert(indices.transferFamily.value());
 
 
 			float queuePriority = 1.0f;
@@ -301,15 +835,16 @@ namespace be {
 				queueCreateInfos.push_back(queueCreateInfo);
 			}
 
-			VkPhysicalDeviceFeatures deviceFeatures = {};
+			// Dynamic rendering falls back to render pass objects, the timeline semaphore to a fence per frame in flight
+			// and present wait to measuring latency up to vkQueuePresentKHR
+			BeDeviceNegotiation negotiation;
+			negotiation.negotiate(vkPhysicalDevice, capabilityRequest, capabilities);
 
 			VkDeviceCreateInfo createInfo = {};
 			createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 			createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 			createInfo.pQueueCreateInfos = queueCreateInfos.data();
-			createInfo.pEnabledFeatures = &deviceFeatures;
-			createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-			createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+			negotiation.apply(createInfo);
 
 			if (enableValidationLayers)
 			{
@@ -324,12 +859,25 @@ namespace be {
 			if (vkCreateDevice(vkPhysicalDevice, &createInfo, nullptr, &vkDevice) != VK_SUCCESS)
 				throw std::runtime_error("Failed to create logical device");
 
+			if (capabilities.presentWait)
+			{
+				vkWaitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(vkDevice, "vkWaitForPresentKHR");
+				capabilities.presentWait = vkWaitForPresent != nullptr;
+			}
+			capabilities.dump(std::cout);
+
 			vkGetDeviceQueue(vkDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
 			vkGetDeviceQueue(vkDevice, indices.presentFamily.value(), 0, &presentQueue);
+
+			if (indices.transferFamily.has_value())
+				vkGetDeviceQueue(vkDevice, indices.transferFamily.value(), 0, &transferQueue);
+			else
+				transferQueue = graphicsQueue;
 		}
 
 		void BeRenderer::createSurface()
 		{
+#ifdef _WIN32
 			VkWin32SurfaceCreateInfoKHR createInfo = {};
 			createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
 			createInfo.hwnd = window->window;
@@ -337,10 +885,19 @@ namespace be {
 
 			if (vkCreateWin32SurfaceKHR(vkInstance, &createInfo, nullptr, &vkSurface) != VK_SUCCESS)
 				throw std::runtime_error("Failed to create win32 surface");
+#else
+			throw std::runtime_error("Surface creation is only supported on Win32, use headless mode");
+#endif
 		}
 
 		void BeRenderer::createSwapChain()
 		{
+			if (headless)
+			{
+				createOffscreenImages();
+				return;
+			}
+
 			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(vkPhysicalDevice);
 
 			VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -350,7 +907,7 @@ namespace be {
 			swapChainExtent = extent;
 			swapChainImageFormat = surfaceFormat.format;
 
-			uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+			uint32_t imageCount = swapChainSupport.capabilities.minImageCount + latencySettings(latencyMode).extraImages;
 			if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
 				imageCount = swapChainSupport.capabilities.maxImageCount;
 
@@ -363,6 +920,13 @@ namespace be {
 			createInfo.imageExtent = extent;
 			createInfo.imageArrayLayers = 1;
 			createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			// Captured frames are copied straight out of the swapchain image
+			if (isCapturing())
+			{
+				if ((swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) == 0)
+					throw std::runtime_error("Swapchain images can't be copied from, capture isn't supported on this surface");
+				createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			}
 
 			QueueFamilyIndices indices = findQueueFamilies(vkPhysicalDevice);
 			uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
@@ -384,7 +948,8 @@ namespace be {
 			createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 			createInfo.presentMode = presentMode;
 			createInfo.clipped = VK_TRUE;
-			createInfo.oldSwapchain = VK_NULL_HANDLE;
+			// Still the retired swapchain during a rebuild, the driver can hand its resources over to the new one
+			createInfo.oldSwapchain = swapChain;
 
 			if (vkCreateSwapchainKHR(vkDevice, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
 				throw std::runtime_error("Could not create swapchain");
@@ -392,6 +957,36 @@ namespace be {
 			vkGetSwapchainImagesKHR(vkDevice, swapChain, &imageCount, nullptr);
 			swapChainImages.resize(imageCount);
 			vkGetSwapchainImagesKHR(vkDevice, swapChain, &imageCount, swapChainImages.data());
+
+			std::cout << "swapchain: " << latencyModeName(latencyMode) << " latency, " << presentModeName(presentMode) << ", "
+				<< imageCount << " images, " << framesInFlight << " frames in flight" << std::endl;
+		}
+
+		void BeRenderer::createOffscreenImages()
+		{
+			swapChainExtent = headlessExtent;
+			swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+
+			swapChainImages.resize(headlessImageCount);
+			offscreenImageAllocations.resize(headlessImageCount);
+
+			for (size_t i = 0; i < swapChainImages.size(); i++)
+			{
+				VkImageCreateInfo imageInfo = {};
+				imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+				imageInfo.imageType = VK_IMAGE_TYPE_2D;
+				imageInfo.format = swapChainImageFormat;
+				imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+				imageInfo.mipLevels = 1;
+				imageInfo.arrayLayers = 1;
+				imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+				imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+				imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+				imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+				imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+				allocator.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageAllocations[i]);
+			}
 		}
 
 		void BeRenderer::createImageViews()
@@ -422,14 +1017,14 @@ namespace be {
 			}
 		}
 
-		void BeRenderer::createGraphicsPipeline()
+		void BeRenderer::createShaderModules()
 		{
-			auto vertShaderCode = readFile("shaders/vert.spv");
-			auto fragShaderCode = readFile("shaders/frag.spv");
-
-			VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-			VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+			vertShaderModule = createShaderModule(assets.get("shaders/vert.spv"));
+			fragShaderModule = createShaderModule(assets.get("shaders/frag.spv"));
+		}
 
+		void BeRenderer::createGraphicsPipeline()
+		{
 			VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
 			vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 			vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -454,13 +1049,21 @@ namespace be {
 			dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 			dynamicState.pDynamicStates = dynamicStates.data();
 
-			auto bindingDescription = Vertex::getBindingDescription();
-			auto attributeDescriptions = Vertex::getAttributeDescriptions();
+			VkVertexInputBindingDescription bindingDescriptions[] = {
+				Vertex::getBindingDescription(),
+				QuadInstance::getBindingDescription()
+			};
+
+			std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+			for (const auto& description : Vertex::getAttributeDescriptions())
+				attributeDescriptions.push_back(description);
+			for (const auto& description : QuadInstance::getAttributeDescriptions())
+				attributeDescriptions.push_back(description);
 
 			VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 			vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-			vertexInputInfo.vertexBindingDescriptionCount = 1;
-			vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputInfo.vertexBindingDescriptionCount = 2;
+			vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions;
 			vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
 			vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -531,82 +1134,135 @@ namespace be {
 			pipelineInfo.pColorBlendState = &colorBlending;
 			pipelineInfo.pDynamicState = &dynamicState;
 			pipelineInfo.layout = vkPipelineLayout;
-			pipelineInfo.renderPass = vkRenderPass;
+			pipelineInfo.renderPass = graph.getRenderPass(scenePass);
+
+			// Without a render pass the attachment formats are declared here instead
+			std::vector<VkFormat> colorFormats = graph.getColorFormats(scenePass);
+			VkPipelineRenderingCreateInfo renderingInfo = {};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+			renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+			renderingInfo.pColorAttachmentFormats = colorFormats.data();
+			if (graph.usesDynamicRendering())
+				pipelineInfo.pNext = &renderingInfo;
 			pipelineInfo.subpass = 0;
 			pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 			pipelineInfo.basePipelineIndex = -1;
 
-			if (vkCreateGraphicsPipelines(vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &vkGraphicsPipeline) != VK_SUCCESS)
+			// Timed as a startup stage, together with the cache state
+			if (vkCreateGraphicsPipelines(vkDevice, vkPipelineCache, 1, &pipelineInfo, nullptr, &vkGraphicsPipeline) != VK_SUCCESS)
 				throw std::runtime_error("failed to create graphics pipeline");
 
 			vkDestroyShaderModule(vkDevice, vertShaderModule, nullptr);
 			vkDestroyShaderModule(vkDevice, fragShaderModule, nullptr);
+			vertShaderModule = fragShaderModule = VK_NULL_HANDLE;
 		}
 
-		void BeRenderer::createRenderPass()
+		void BeRenderer::createPipelineCache(std::vector<char>& cacheData)
 		{
-			VkAttachmentDescription colorAttachment = {};
-			colorAttachment.format = swapChainImageFormat;
-			colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-			colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-			colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			// A blob from another driver or GPU is at best ignored by the driver, at worst crashes it, so check it ourselves
+			if (!cacheData.empty())
+			{
+				VkPhysicalDeviceProperties deviceProps;
+				vkGetPhysicalDeviceProperties(vkPhysicalDevice, &deviceProps);
 
-			VkAttachmentReference colorAttachmentRef = {};
-			colorAttachmentRef.attachment = 0;
-			colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				VkPipelineCacheHeaderVersionOne header = {};
+				bool valid = cacheData.size() >= sizeof(header);
+				if (valid)
+				{
+					memcpy(&header, cacheData.data(), sizeof(header));
+					valid = header.headerSize >= sizeof(header) && header.headerSize <= cacheData.size()
+						&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+						&& header.vendorID == deviceProps.vendorID
+						&& header.deviceID == deviceProps.deviceID
+						&& memcmp(header.pipelineCacheUUID, deviceProps.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+				}
 
-			VkSubpassDescription subpass = {};
-			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-			subpass.colorAttachmentCount = 1;
-			subpass.pColorAttachments = &colorAttachmentRef;
+				if (!valid)
+				{
+					std::cout << "pipeline cache on disk does not match this device, starting cold" << std::endl;
+					cacheData.clear();
+				}
+			}
 
-			VkSubpassDependency dependency = {};
-			dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependency.dstSubpass = 0;
-			dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependency.srcAccessMask = 0;
-			dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			VkPipelineCacheCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			createInfo.initialDataSize = cacheData.size();
+			createInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
 
-			VkRenderPassCreateInfo renderPassInfo = {};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-			renderPassInfo.attachmentCount = 1;
-			renderPassInfo.pAttachments = &colorAttachment;
-			renderPassInfo.subpassCount = 1;
-			renderPassInfo.pSubpasses = &subpass;
-			renderPassInfo.dependencyCount = 1;
-			renderPassInfo.pDependencies = &dependency;
+			if (vkCreatePipelineCache(vkDevice, &createInfo, nullptr, &vkPipelineCache) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create pipeline cache");
 
-			if (vkCreateRenderPass(vkDevice, &renderPassInfo, nullptr, &vkRenderPass) != VK_SUCCESS)
-				throw std::runtime_error("failed to create render pass");
+			pipelineCacheWarm = !cacheData.empty();
 		}
 
-		void BeRenderer::createFramebuffers()
+		void BeRenderer::savePipelineCache()
 		{
-			swapChainFramebuffers.resize(swapChainImageViews.size());
+			if (vkPipelineCache == VK_NULL_HANDLE)
+				return;
 
-			for (size_t i = 0; i < swapChainImageViews.size(); i++)
-			{
-				VkImageView attachments[] = {
-					swapChainImageViews[i]
-				};
+			size_t dataSize = 0;
+			if (vkGetPipelineCacheData(vkDevice, vkPipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+				return;
+
+			std::vector<char> cacheData(dataSize);
+			if (vkGetPipelineCacheData(vkDevice, vkPipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+				return;
 
-				VkFramebufferCreateInfo framebufferInfo = {};
-				framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-				framebufferInfo.renderPass = vkRenderPass;
-				framebufferInfo.attachmentCount = 1;
-				framebufferInfo.pAttachments = attachments;
-				framebufferInfo.width = swapChainExtent.width;
-				framebufferInfo.height = swapChainExtent.height;
-				framebufferInfo.layers = 1;
+			if (!writeFileAtomic(getExecutableDir() + "pipeline_cache.bin", cacheData.data(), dataSize))
+				std::cerr << "Failed to write pipeline cache" << std::endl;
+		}
+
+		void BeRenderer::createRenderGraph()
+		{
+			graph.init(vkDevice, &allocator);
+			graph.setDynamicRendering(capabilities.dynamicRendering);
 
-				if (vkCreateFramebuffer(vkDevice, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
-					throw std::runtime_error("Failed to create framebuffer!");
+			// PRESENT_SRC is only valid with VK_KHR_swapchain, offscreen images are left ready for readback
+			backbuffer = graph.importImage("backbuffer", swapChainImageFormat, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, headless ? ImageUsage::TransferSrc : ImageUsage::Present);
+
+			BeRenderGraph::ColorAttachment target = { backbuffer, true, SCENE_CLEAR_COLOR };
+			scenePass = graph.addRasterPass("scene", { target }, {}, recordThreads > 0, [this](VkCommandBuffer commandBuffer, const BeRenderGraph::PassContext& context) {
+				uint32_t drawCount = drawCounts[currentFrame];
+				if (recordThreads == 0)
+				{
+					profiler.cmdBeginDraw(commandBuffer, currentFrame);
+					recordDraws(commandBuffer, currentFrame, 0, drawCount);
+					profiler.cmdEndDraw(commandBuffer, currentFrame);
+					return;
+				}
+
+				VkCommandBufferInheritanceInfo inheritance = {};
+				inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+				inheritance.renderPass = context.renderPass;
+				inheritance.subpass = 0;
+				inheritance.framebuffer = context.framebuffer;
+				inheritance.pipelineStatistics = profiler.inheritedStatistics();
+
+				std::vector<VkFormat> colorFormats = graph.getColorFormats(scenePass);
+				VkCommandBufferInheritanceRenderingInfo renderingInfo = inheritedRendering(colorFormats);
+				if (graph.usesDynamicRendering())
+					inheritance.pNext = &renderingInfo;
+
+				uint32_t frameIndex = currentFrame;
+				const auto& secondaries = recorder.record(frameIndex * static_cast<uint32_t>(swapChainImages.size()) + context.imageIndex, inheritance, drawCount,
+					[this, frameIndex](VkCommandBuffer secondary, uint32_t first, uint32_t count) {
+						recordDraws(secondary, frameIndex, first, count);
+					});
+
+				if (!secondaries.empty())
+					vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+			});
+
+			if (isCapturing())
+			{
+				// The copy goes into the readback buffer of the frame slot, which stays the same for a cached command buffer
+				graph.addPass("capture", { { backbuffer, ImageUsage::TransferSrc } }, [this](VkCommandBuffer commandBuffer, const BeRenderGraph::PassContext& context) {
+					capture.cmdCopy(commandBuffer, graph.getImage(backbuffer, context.imageIndex), currentFrame);
+				});
 			}
+
+			graph.setImportedImages(backbuffer, swapChainImages, swapChainImageViews);
+			graph.compile(swapChainExtent);
 		}
 
 		void BeRenderer::createCommandTool()
@@ -624,40 +1280,114 @@ namespace be {
 
 		void BeRenderer::createCommandBuffer()
 		{
-			commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+			createAcquireCommandBuffers();
+			createCachedCommandBuffers();
+
+			if (recordThreads > 0)
+			{
+				QueueFamilyIndices indices = findQueueFamilies(vkPhysicalDevice);
+				recorder.init(vkDevice, indices.graphicsFamily.value(), jobs, recordThreads, static_cast<uint32_t>(cachedCommandBuffers.size()));
+			}
+		}
+
+		void BeRenderer::createAcquireCommandBuffers()
+		{
+			acquireCommandBuffers.resize(framesInFlight);
 
 			VkCommandBufferAllocateInfo allocInfo = {};
 			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 			allocInfo.commandPool = commandPool;
 			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-			allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+			allocInfo.commandBufferCount = static_cast<uint32_t>(acquireCommandBuffers.size());
 
-			if (vkAllocateCommandBuffers(vkDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+			if (vkAllocateCommandBuffers(vkDevice, &allocInfo, acquireCommandBuffers.data()) != VK_SUCCESS)
 				throw std::runtime_error("failed to allocate command buffer");
+		}
+
+		void BeRenderer::createCachedCommandBuffers()
+		{
+			// One per frame in flight and swapchain image: the framebuffer, instance and indirect buffers all differ
+			::std::vector<VkCommandBuffer> buffers(framesInFlight * swapChainImages.size());
 
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = commandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = static_cast<uint32_t>(buffers.size());
+
+			if (vkAllocateCommandBuffers(vkDevice, &allocInfo, buffers.data()) != VK_SUCCESS)
+				throw std::runtime_error("failed to allocate command buffer");
+
+			cachedCommandBuffers.resize(buffers.size());
+			for (size_t i = 0; i < buffers.size(); i++)
+			{
+				cachedCommandBuffers[i].commandBuffer = buffers[i];
+				cachedCommandBuffers[i].dirty = true;
+			}
 		}
 
 		void BeRenderer::createSyncObjects()
 		{
-			imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-			renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-			inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+			imageAvailableSemaphores.resize(framesInFlight, VK_NULL_HANDLE);
+			renderFinishedSemaphores.resize(framesInFlight, VK_NULL_HANDLE);
+			frameNumbers.assign(framesInFlight, 0);
 
 			VkSemaphoreCreateInfo semaphoreInfo = {};
 			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-			VkFenceCreateInfo fenceInfo = {};
-			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-			fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-			for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			for (size_t i = 0; i < framesInFlight; i++) {
 				if (vkCreateSemaphore(vkDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-					vkCreateSemaphore(vkDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-					vkCreateFence(vkDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+					vkCreateSemaphore(vkDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
 				{
 					throw std::runtime_error("failed to create semaphore");
 				}
 			}
+
+			if (capabilities.timelineSemaphore)
+			{
+				// Recreated only while the device is idle, so everything submitted so far counts as finished
+				VkSemaphoreTypeCreateInfo typeInfo = {};
+				typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+				typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+				typeInfo.initialValue = submittedFrames;
+
+				VkSemaphoreCreateInfo timelineInfo = {};
+				timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+				timelineInfo.pNext = &typeInfo;
+
+				if (vkCreateSemaphore(vkDevice, &timelineInfo, nullptr, &frameTimeline) != VK_SUCCESS)
+					throw std::runtime_error("failed to create frame timeline semaphore");
+				return;
+			}
+
+			inFlightFences.resize(framesInFlight, VK_NULL_HANDLE);
+
+			VkFenceCreateInfo fenceInfo = {};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+			for (size_t i = 0; i < framesInFlight; i++) {
+				if (vkCreateFence(vkDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+					throw std::runtime_error("failed to create fence");
+			}
+		}
+
+		void BeRenderer::destroySyncObjects()
+		{
+			for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
+				vkDestroySemaphore(vkDevice, imageAvailableSemaphores[i], nullptr);
+				vkDestroySemaphore(vkDevice, renderFinishedSemaphores[i], nullptr);
+			}
+			for (auto fence : inFlightFences)
+				vkDestroyFence(vkDevice, fence, nullptr);
+			if (frameTimeline != VK_NULL_HANDLE)
+				vkDestroySemaphore(vkDevice, frameTimeline, nullptr);
+
+			imageAvailableSemaphores.clear();
+			renderFinishedSemaphores.clear();
+			inFlightFences.clear();
+			frameTimeline = VK_NULL_HANDLE;
+			frameNumbers.clear();
 		}
 
 		void BeRenderer::createVertexBuffer()
@@ -665,41 +1395,209 @@ namespace be {
 			VkBufferCreateInfo bufferInfo = {};
 			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 			bufferInfo.size = sizeof(vertices[0]) * vertices.size();
+			bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation);
+
+			staging.write(vertexBuffer, 0, vertices.data(), bufferInfo.size);
+		}
+
+		void BeRenderer::createIndexBuffer()
+		{
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = sizeof(indices[0]) * indices.size();
+			bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation);
+
+			staging.write(indexBuffer, 0, indices.data(), bufferInfo.size);
+		}
+
+		void BeRenderer::createInstanceBuffers()
+		{
+			resizeInstanceBuffers(framesInFlight);
+		}
+
+		void BeRenderer::resizeInstanceBuffers(uint32_t frameCount)
+		{
+			// Frames that stay keep their grown buffers, dropped frames free theirs
+			for (size_t i = frameCount; i < instanceBuffers.size(); i++)
+			{
+				allocator.destroyBuffer(instanceBuffers[i], instanceAllocations[i]);
+				allocator.destroyBuffer(indirectBuffers[i], indirectAllocations[i]);
+			}
+
+			uint32_t firstNew = static_cast<uint32_t>(instanceBuffers.size());
+
+			instanceBuffers.resize(frameCount, VK_NULL_HANDLE);
+			instanceAllocations.resize(frameCount);
+			instanceCapacities.resize(frameCount, 0);
+			instanceCounts.resize(frameCount, 0);
+			indirectBuffers.resize(frameCount, VK_NULL_HANDLE);
+			indirectAllocations.resize(frameCount);
+			drawCounts.resize(frameCount, 0);
+
+			for (uint32_t i = firstNew; i < frameCount; i++)
+				growInstanceBuffer(i, INITIAL_INSTANCE_CAPACITY);
+		}
+
+		void BeRenderer::growInstanceBuffer(uint32_t frameIndex, size_t count)
+		{
+			if (instanceBuffers[frameIndex] != VK_NULL_HANDLE)
+				allocator.destroyBuffer(instanceBuffers[frameIndex], instanceAllocations[frameIndex]);
+			if (indirectBuffers[frameIndex] != VK_NULL_HANDLE)
+				allocator.destroyBuffer(indirectBuffers[frameIndex], indirectAllocations[frameIndex]);
+
+			size_t capacity = INITIAL_INSTANCE_CAPACITY;
+			while (capacity < count)
+				capacity *= 2;
+
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = sizeof(QuadInstance) * capacity;
 			bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-			if (vkCreateBuffer(vkDevice, &bufferInfo, nullptr, &vertexBuffer) != VK_SUCCESS)
-				throw std::runtime_error("Failed to create vertex buffer");
+			allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				instanceBuffers[frameIndex], instanceAllocations[frameIndex]);
+			instanceCapacities[frameIndex] = capacity;
+
+			// Inline recording draws the whole batch with one indirect draw. Secondary buffers get one per
+			// INSTANCES_PER_DRAW instances of capacity, so ranges can be recorded independently.
+			uint32_t drawCount = recordThreads > 0 ? static_cast<uint32_t>((capacity + INSTANCES_PER_DRAW - 1) / INSTANCES_PER_DRAW) : 1;
+
+			VkBufferCreateInfo indirectInfo = {};
+			indirectInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			indirectInfo.size = sizeof(VkDrawIndexedIndirectCommand) * drawCount;
+			indirectInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+			indirectInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			allocator.createBuffer(indirectInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				indirectBuffers[frameIndex], indirectAllocations[frameIndex]);
+			drawCounts[frameIndex] = drawCount;
+
+			// The buffer handle is baked into the frame's recorded commands
+			invalidateCommandBuffers(frameIndex);
 		}
 
-		void BeRenderer::cleanupSwapChain()
+		void BeRenderer::updateInstanceBuffer(uint32_t frameIndex)
 		{
-			for (size_t i = 0; i < swapChainFramebuffers.size(); i++)
-				vkDestroyFramebuffer(vkDevice, swapChainFramebuffers[i], nullptr);
+			// The frame's fence has been waited on, so its buffer is free to be rewritten or replaced
+			size_t count = batch.size();
+			if (count > instanceCapacities[frameIndex])
+				growInstanceBuffer(frameIndex, count);
 
-			for (size_t i = 0; i < swapChainImageViews.size(); i++)
-				vkDestroyImageView(vkDevice, swapChainImageViews[i], nullptr);
+			if (count > 0)
+			{
+				auto* mapped = static_cast<QuadInstance*>(instanceAllocations[frameIndex].mapped);
+				const QuadInstance* quads = batch.data();
+				auto copy = [mapped, quads](uint32_t begin, uint32_t end) {
+					memcpy(mapped + begin, quads + begin, sizeof(QuadInstance) * (end - begin));
+				};
+
+				if (jobs != nullptr)
+					jobs->parallelFor(static_cast<uint32_t>(count), INSTANCES_PER_COPY_JOB, copy);
+				else
+					copy(0, static_cast<uint32_t>(count));
+			}
 
-			vkDestroySwapchainKHR(vkDevice, swapChain, nullptr);
+			instanceCounts[frameIndex] = static_cast<uint32_t>(count);
+
+			auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(indirectAllocations[frameIndex].mapped);
+			uint32_t instancesPerDraw = recordThreads > 0 ? static_cast<uint32_t>(INSTANCES_PER_DRAW) : instanceCounts[frameIndex];
+			for (uint32_t i = 0; i < drawCounts[frameIndex]; i++)
+			{
+				uint32_t first = i * instancesPerDraw;
+				commands[i].indexCount = static_cast<uint32_t>(indices.size());
+				commands[i].instanceCount = instanceCounts[frameIndex] > first ? std::min(instanceCounts[frameIndex] - first, instancesPerDraw) : 0;
+				commands[i].firstIndex = 0;
+				commands[i].vertexOffset = 0;
+				commands[i].firstInstance = first;
+			}
+		}
+
+		void BeRenderer::retireSwapChain(uint64_t frame)
+		{
+			// The handle stays in swapChain, createSwapChain passes it on as the old swapchain
+			RetiredSwapChain retired;
+			retired.frame = frame;
+			retired.swapChain = swapChain;
+			retired.imageViews.swap(swapChainImageViews);
+
+			if (headless)
+			{
+				retired.offscreenImages.swap(swapChainImages);
+				retired.offscreenImageAllocations.swap(offscreenImageAllocations);
+			}
+
+			for (const auto& cached : cachedCommandBuffers)
+				retired.commandBuffers.push_back(cached.commandBuffer);
+			cachedCommandBuffers.clear();
+
+			retiredSwapChains.push_back(std::move(retired));
+		}
+
+		void BeRenderer::destroyRetired(uint64_t completedFrame)
+		{
+			while (!retiredSwapChains.empty() && retiredSwapChains.front().frame <= completedFrame)
+			{
+				RetiredSwapChain& retired = retiredSwapChains.front();
+
+				if (!retired.commandBuffers.empty())
+					vkFreeCommandBuffers(vkDevice, commandPool, static_cast<uint32_t>(retired.commandBuffers.size()), retired.commandBuffers.data());
+				for (auto pool : retired.commandPools)
+					vkDestroyCommandPool(vkDevice, pool, nullptr);
+
+				graph.destroyObjects(retired.graph);
+				for (auto imageView : retired.imageViews)
+					vkDestroyImageView(vkDevice, imageView, nullptr);
+				for (size_t i = 0; i < retired.offscreenImages.size(); i++)
+					allocator.destroyImage(retired.offscreenImages[i], retired.offscreenImageAllocations[i]);
+
+				if (retired.swapChain != VK_NULL_HANDLE)
+					vkDestroySwapchainKHR(vkDevice, retired.swapChain, nullptr);
+
+				retiredSwapChains.pop_front();
+			}
 		}
 
 		void BeRenderer::recreateSwapChain()
 		{
-			vkDeviceWaitIdle(vkDevice);
+			// Present ids belong to the swapchain that is about to go away
+			pendingPresents.clear();
 
-			cleanupSwapChain();
+			// No device wait: frames in flight keep using the old objects. Presentation isn't covered by any fence, so
+			// the old swapchain is kept until a full round of frames on the new one has completed, by which time the
+			// presentation engine has moved on to the new images.
+			retireSwapChain(submittedFrames + framesInFlight);
 
 			createSwapChain();
 			createImageViews();
-			createFramebuffers();
+			// Buffers with a capture in flight are kept until it has been read
+			if (isCapturing())
+				capture.resize(framesInFlight, swapChainExtent, swapChainImageFormat);
+
+			// Only the framebuffers are rebuilt unless the extent changed, whatever the graph replaces waits with the
+			// retired swapchain
+			graph.setImportedImages(backbuffer, swapChainImages, swapChainImageViews);
+			graph.compile(swapChainExtent, &retiredSwapChains.back().graph);
+
+			// Framebuffers, extent and possibly the image count changed
+			createCachedCommandBuffers();
+			if (recordThreads > 0)
+				recorder.resize(static_cast<uint32_t>(cachedCommandBuffers.size()), &retiredSwapChains.back().commandPools);
 		}
 
-		VkShaderModule BeRenderer::createShaderModule(const::std::vector<char>& code)
+		VkShaderModule BeRenderer::createShaderModule(const AssetView& code)
 		{
+			// Pack entries are 4 byte aligned, so SPIR-V is consumed straight from the mapping
 			VkShaderModuleCreateInfo createInfo = {};
 			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-			createInfo.codeSize = code.size();
-			createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+			createInfo.codeSize = code.size;
+			createInfo.pCode = static_cast<const uint32_t*>(code.data);
 
 			VkShaderModule shaderModule;
 			if (vkCreateShaderModule(vkDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
@@ -710,10 +1608,10 @@ namespace be {
 
 		VkPresentModeKHR BeRenderer::chooseSwapPresentMode(const ::std::vector<VkPresentModeKHR>& availablePresentModes)
 		{
-			for (const auto& apMode : availablePresentModes)
+			for (VkPresentModeKHR preferred : latencySettings(latencyMode).presentModes)
 			{
-				if (apMode == VK_PRESENT_MODE_MAILBOX_KHR)
-					return apMode;
+				if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferred) != availablePresentModes.end())
+					return preferred;
 			}
 			
 			return VK_PRESENT_MODE_FIFO_KHR;
@@ -725,6 +1623,7 @@ namespace be {
 				return capabilities.currentExtent;
 			else
 			{
+#ifdef _WIN32
 				RECT rr;
 				GetClientRect(window->window, &rr);
 
@@ -732,6 +1631,12 @@ namespace be {
 					static_cast<uint32_t>(rr.right - rr.left),
 					static_cast<uint32_t>(rr.bottom - rr.top)
 				};
+#else
+				VkExtent2D actualExtent = {
+					static_cast<uint32_t>(window->width),
+					static_cast<uint32_t>(window->height)
+				};
+#endif
 
 				actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
 				actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
@@ -771,9 +1676,17 @@ namespace be {
 					indices.graphicsFamily = i;
 				}
 
-				VkBool32 presentSupport = false;
-				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, vkSurface, &presentSupport);
-				if (presentSupport) indices.presentFamily = i;
+				if (headless)
+				{
+					// Nothing is presented, the "present" queue is just the graphics one
+					indices.presentFamily = indices.graphicsFamily;
+				}
+				else
+				{
+					VkBool32 presentSupport = false;
+					vkGetPhysicalDeviceSurfaceSupportKHR(device, i, vkSurface, &presentSupport);
+					if (presentSupport) indices.presentFamily = i;
+				}
 
 				if (indices.isComplete())
 					break;
@@ -781,25 +1694,17 @@ namespace be {
 				i++;
 			}
 
-			return indices;
-		}
-
-		bool BeRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
-		{
-			uint32_t extensionCount;
-			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-
-			std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
-
-			std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-
-			for (const auto& extension : availableExtensions)
+			for (uint32_t family = 0; family < queueFamilyCount; family++)
 			{
-				requiredExtensions.erase(extension.extensionName);
+				VkQueueFlags flags = queueFamilies[family].queueFlags;
+				if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+				{
+					indices.transferFamily = family;
+					break;
+				}
 			}
 
-			return requiredExtensions.empty();
+			return indices;
 		}
 
 		SwapChainSupportDetails BeRenderer::querySwapChainSupport(VkPhysicalDevice device)
@@ -831,58 +1736,59 @@ namespace be {
 
 		void BeRenderer::terminateVk()
 		{
-			for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-				vkDestroySemaphore(vkDevice, imageAvailableSemaphores[i], nullptr);
-				vkDestroySemaphore(vkDevice, renderFinishedSemaphores[i], nullptr);
-				vkDestroyFence(vkDevice, inFlightFences[i], nullptr);
-			}
+			// init may have thrown anywhere, only what was created goes
+			if (vkDevice != VK_NULL_HANDLE)
+			{
+				waitIdle();
 
-			vkDestroyBuffer(vkDevice, vertexBuffer, nullptr);
+				if (isCapturing())
+					capture.destroy();
 
-			vkDestroyCommandPool(vkDevice, commandPool, nullptr);
+				destroySyncObjects();
 
-			cleanupSwapChain();
+				profiler.destroy(vkDevice);
 
-			vkDestroyPipeline(vkDevice, vkGraphicsPipeline, nullptr);
-			vkDestroyPipelineLayout(vkDevice, vkPipelineLayout, nullptr);
-			vkDestroyRenderPass(vkDevice, vkRenderPass, nullptr);
+				allocator.destroyBuffer(vertexBuffer, vertexBufferAllocation);
+				allocator.destroyBuffer(indexBuffer, indexBufferAllocation);
+				for (size_t i = 0; i < instanceBuffers.size(); i++)
+					allocator.destroyBuffer(instanceBuffers[i], instanceAllocations[i]);
+				for (size_t i = 0; i < indirectBuffers.size(); i++)
+					allocator.destroyBuffer(indirectBuffers[i], indirectAllocations[i]);
+				staging.destroy();
 
-			vkDestroyDevice(vkDevice, nullptr);
-			vkDestroySurfaceKHR(vkInstance, vkSurface, nullptr);
+				// The device is idle, the current swapchain goes with everything retired before it
+				retireSwapChain(0);
+				destroyRetired(UINT64_MAX);
+				graph.destroy();
 
-			if (enableValidationLayers)
-			{
-				auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(vkInstance, "vkDestroyDebugUtilsMessengerEXT");
-				if (func != nullptr)
-					func(vkInstance, vkDebugMessenger, nullptr);
-			}
+				if (recordThreads > 0)
+					recorder.destroy();
+				vkDestroyCommandPool(vkDevice, commandPool, nullptr);
 
-			vkDestroyInstance(vkInstance, nullptr);
-		}
+				allocator.destroy();
 
-		std::vector<const char*> BeRenderer::getRequiredExtensions()
-		{
-			uint32_t extensionCount = 0;
-			if (!vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr) == VK_SUCCESS)
-			{
-				throw std::runtime_error("Error enumerating extensions");
-			}
+				savePipelineCache();
+				vkDestroyPipelineCache(vkDevice, vkPipelineCache, nullptr);
 
-			std::vector<VkExtensionProperties> supportedExtensions(extensionCount);
-			if (!vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, supportedExtensions.data()) == VK_SUCCESS)
-			{
-				throw std::runtime_error("Error enumerating extensions");
+				vkDestroyPipeline(vkDevice, vkGraphicsPipeline, nullptr);
+				vkDestroyPipelineLayout(vkDevice, vkPipelineLayout, nullptr);
+
+				vkDestroyDevice(vkDevice, nullptr);
 			}
 
-			std::vector<const char*> requiredExtensions;
-			for (auto& ext : supportedExtensions)
+			assets.close();
+			if (vkSurface != VK_NULL_HANDLE)
+				vkDestroySurfaceKHR(vkInstance, vkSurface, nullptr);
+
+			if (enableValidationLayers && vkDebugMessenger != VK_NULL_HANDLE)
 			{
-				char* ex = (char*)malloc(sizeof(char) * 256);
-				strcpy_s(ex, sizeof(char) * 256, ext.extensionName);
-				requiredExtensions.push_back(ex);
+				auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(vkInstance, "vkDestroyDebugUtilsMessengerEXT");
+				if (func != nullptr)
+					func(vkInstance, vkDebugMessenger, nullptr);
 			}
 
-			return requiredExtensions;
+			if (vkInstance != VK_NULL_HANDLE)
+				vkDestroyInstance(vkInstance, nullptr);
 		}
 
 		bool BeRenderer::checkValidationLayerSupport()
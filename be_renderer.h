@@ -1,8 +1,20 @@
 #pragma once
 
 #include "be_window.h"
-
+#include "be_profiler.h"
+#include "be_allocator.h"
+#include "be_staging.h"
+#include "be_asset_pack.h"
+#include "be_batch.h"
+#include "be_recorder.h"
+#include "be_latency.h"
+#include "be_render_graph.h"
+#include "be_capabilities.h"
+#include "be_capture.h"
+
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #include <vulkan/vulkan.h>
 
 #include <glm/glm.hpp>
@@ -10,16 +22,30 @@
 #include <vector>
 #include <optional>
 #include <array>
+#include <deque>
+#include <chrono>
+#include <ostream>
+#include <string>
 
 namespace be
 {
 	namespace renderer {
 
-		const int MAX_FRAMES_IN_FLIGHT = 2;
+		// Upper bound of the frames in flight of any latency mode, the staging ring and profiler keep this many
+		// per frame slots
+		const int MAX_FRAMES_IN_FLIGHT = 3;
+		const VkClearColorValue SCENE_CLEAR_COLOR = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+		const size_t INITIAL_INSTANCE_CAPACITY = 1024;
+		// Instances per indirect draw when recording into secondary command buffers
+		const size_t INSTANCES_PER_DRAW = 1024;
+		// Instances each job copies into the mapped instance buffer, a few hundred KB
+		const uint32_t INSTANCES_PER_COPY_JOB = 8192;
+		// Presents waiting for their display time before the oldest is given up on, e.g. while minimized
+		const size_t MAX_PENDING_PRESENTS = 64;
 
 		struct Vertex {
 			glm::vec2 pos;
-			glm::vec3 color;
+			glm::vec2 uv;
 
 			static VkVertexInputBindingDescription getBindingDescription()
 			{
@@ -43,23 +69,44 @@ namespace be
 
 				descriptions[1].binding = 0;
 				descriptions[1].location = 1;
-				descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-				descriptions[1].offset = offsetof(Vertex, color);
+				descriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+				descriptions[1].offset = offsetof(Vertex, uv);
 
 				return descriptions;
 			}
 		};
 
+		// Unit quad centered on the origin, scaled and placed per QuadInstance
 		const ::std::vector<Vertex> vertices = {
-			{{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-			{{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
-			{{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+			{{-0.5f, -0.5f}, {0.0f, 0.0f}},
+			{{0.5f, -0.5f}, {1.0f, 0.0f}},
+			{{0.5f, 0.5f}, {1.0f, 1.0f}},
+			{{-0.5f, 0.5f}, {0.0f, 1.0f}}
+		};
+
+		const ::std::vector<uint16_t> indices = {
+			0, 1, 2, 2, 3, 0
 		};
 
+		// Trade between input to photon latency and throughput, switchable at runtime with a swapchain rebuild
+		enum class LatencyMode
+		{
+			// Two frames in flight, one spare swapchain image, MAILBOX when available
+			Balanced,
+			// One frame in flight, the minimum image count, IMMEDIATE or FIFO_RELAXED so a late frame is shown at once
+			LowLatency,
+			// Three frames in flight, two spare images, uncapped present for benchmarking
+			Throughput
+		};
+
+		const char* latencyModeName(LatencyMode mode);
+
 		struct QueueFamilyIndices
 		{
 			::std::optional<uint32_t> graphicsFamily;
 			::std::optional<uint32_t> presentFamily;
+			// Only set for a transfer capable family without graphics, uploads fall back to the graphics queue otherwise
+			::std::optional<uint32_t> transferFamily;
 
 			bool isComplete()
 			{
@@ -74,15 +121,87 @@ namespace be
 			::std::vector<VkPresentModeKHR> presentModes;
 		};
 
+		// One step of BeRenderer::init, times are relative to the start of init
+		struct StartupStage
+		{
+			const char* name;
+			double startMs;
+			double durationMs;
+			// Ran on the startup worker next to the main thread
+			bool worker;
+		};
+
 		class BeRenderer
 		{
 		public:
 			BeRenderer(BeWindow* window) : window(window) {}
+			// Headless mode: renders into imageCount device-owned images of the given extent, no surface or swapchain
+			BeRenderer(VkExtent2D extent, uint32_t imageCount) : headless(true), headlessExtent(extent), headlessImageCount(imageCount) {}
 			~BeRenderer();
 
+			// Records draws into this many secondary command buffers, 0 records inline. Call before init.
+			void setRecordThreads(uint32_t count) { recordThreads = count; capabilityRequest.secondaryCommandBuffers = count > 0; }
+			// false keeps render pass and framebuffer objects even where dynamic rendering is supported. Call before init.
+			void setDynamicRendering(bool allowed) { capabilityRequest.dynamicRendering = allowed; }
+			// false tracks frames with a fence per frame in flight even where timeline semaphores are supported. Call before init.
+			void setTimelineSync(bool allowed) { capabilityRequest.timelineSemaphore = allowed; }
+			// Picks a CPU implementation such as lavapipe over any GPU, so output doesn't depend on the machine. Call before init.
+			void setSoftwareRendering(bool preferred) { softwareRendering = preferred; }
+			bool usesDynamicRendering() const { return capabilities.dynamicRendering; }
+			// Hands every rendered frame to sink. Frames are copied into a readback ring and passed on by a thread of their
+			// own, rendering never waits for the sink unless lossless is set. Call before init.
+			void setCapture(BeFrameCapture::FrameSink sink, bool lossless = false) { captureSink = sink; captureLossless = lossless; }
+			bool isCapturing() const { return static_cast<bool>(captureSink); }
+			const BeFrameCapture& getCapture() const { return capture; }
+			// Secondary buffers and instance data are filled as jobs when set. Call before init.
+			void setJobSystem(BeJobSystem* jobs) { this->jobs = jobs; }
+			// Before init this only picks the mode, afterwards it waits for the GPU and rebuilds the swapchain and per frame objects
+			void setLatencyMode(LatencyMode mode);
+			LatencyMode getLatencyMode() const { return latencyMode; }
+
 			bool init();
 			void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
-			void drawFrame();
+			// Blocks until the next frame's slot is free. drawFrame does this itself, calling it first lets input be sampled
+			// after the wait instead of before it.
+			void waitForFrame();
+			// input is the oldest input the frame's simulation ticks consumed, 0 if none
+			void drawFrame(InputTimestamp input = 0);
+
+			// Frames are numbered from 1 in submit order. Anything tied to a frame can check or wait for it to finish on
+			// the GPU instead of keeping a fence of its own.
+			uint64_t getSubmittedFrame() const { return submittedFrames; }
+			bool isFrameComplete(uint64_t frame);
+			void waitForFrameNumber(uint64_t frame);
+			// Reaches each frame's number once its submission finished, null when frames are tracked with fences
+			VkSemaphore getFrameTimeline() const { return frameTimeline; }
+			bool usesTimelineSync() const { return capabilities.timelineSemaphore; }
+			void waitIdle();
+
+			bool isHeadless() const { return headless; }
+			const BeProfiler& getProfiler() const { return profiler; }
+			// Quads submitted here are drawn by the next drawFrame
+			BeQuadBatch& getBatch() { return batch; }
+			AllocatorStats getAllocatorStats() const { return allocator.stats(); }
+			// Number of times a cached command buffer had to be (re)recorded
+			uint64_t getRecordedCommandBuffers() const { return recordedCommandBuffers; }
+			// Input until vkQueuePresentKHR returned for the frame that showed it
+			const BeLatencyHistogram& getPresentLatency() const { return presentLatency; }
+			// Input until the frame reached the display, only with VK_KHR_present_wait
+			const BeLatencyHistogram& getDisplayLatency() const { return displayLatency; }
+			bool hasPresentWait() const { return capabilities.presentWait; }
+			// What instance and device creation negotiated, valid once init returned
+			const RendererCapabilities& getCapabilities() const { return capabilities; }
+			// Device local heap usage and budget in bytes as the driver reports them, both 0 without VK_EXT_memory_budget
+			void getDeviceLocalBudget(VkDeviceSize& usage, VkDeviceSize& budget) const;
+
+			// Average time to record drawCount draws split over threadCount workers, without submitting anything
+			double benchmarkRecording(uint32_t drawCount, uint32_t threadCount, uint32_t iterations);
+
+			const ::std::vector<StartupStage>& getStartupStages() const { return startupStages; }
+			// From the start of init until it returned, and until the first frame was presented, -1 before that
+			double getStartupMs() const { return startupMs; }
+			double getFirstPresentMs() const { return firstPresentMs; }
+			void dumpStartup(::std::ostream& out) const;
 
 		private:
 			void setupDebugMessenger(const VkDebugUtilsMessengerCreateInfoEXT& createInfo);
@@ -92,44 +211,77 @@ namespace be
 			void createLogicDevice();
 			void createSurface();
 			void createSwapChain();
+			void createOffscreenImages();
 			void createImageViews();
+			void createInstance();
+			void createPipelineCache(::std::vector<char>& cacheData);
+			void createShaderModules();
+			void savePipelineCache();
 			void createGraphicsPipeline();
-			void createRenderPass();
-			void createFramebuffers();
+			void createRenderGraph();
 			void createCommandTool();
 			void createCommandBuffer();
+			void createCachedCommandBuffers();
+			uint32_t gatherCommandBuffers(uint32_t imageIndex, VkCommandBuffer* out);
+			void recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t firstDraw, uint32_t drawCount);
+			void invalidateCommandBuffers(uint32_t frameIndex);
+			void collectPresentTimes();
 			void createSyncObjects();
+			void destroySyncObjects();
+			void submitFrame(VkSubmitInfo& submitInfo);
+			void recordFirstPresent();
+			void createAcquireCommandBuffers();
+			void resizeInstanceBuffers(uint32_t frameCount);
 			void createVertexBuffer();
+			void createIndexBuffer();
+			void createInstanceBuffers();
+			void growInstanceBuffer(uint32_t frameIndex, size_t count);
+			void updateInstanceBuffer(uint32_t frameIndex);
 
-			void cleanupSwapChain();
+			void retireSwapChain(uint64_t frame);
+			void destroyRetired(uint64_t completedFrame);
 			void recreateSwapChain();
 
-			VkShaderModule createShaderModule(const ::std::vector<char>& code);
+			VkShaderModule createShaderModule(const AssetView& code);
 
 			VkPresentModeKHR chooseSwapPresentMode(const ::std::vector<VkPresentModeKHR>& availablePresentModes);
 			VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 			VkSurfaceFormatKHR chooseSwapSurfaceFormat(const ::std::vector<VkSurfaceFormatKHR>& availableFormats);
 
 			QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
-			bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 			SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
 			void terminateVk();
 
-			::std::vector<const char*> getRequiredExtensions();
 			bool checkValidationLayerSupport();
 
 		private:
 			BeWindow* window = nullptr;
 
+			bool headless = false;
+			VkExtent2D headlessExtent = {};
+			uint32_t headlessImageCount = 0;
+			uint32_t headlessImageIndex = 0;
+			bool softwareRendering = false;
+			::std::vector<Allocation> offscreenImageAllocations;
+
 			VkInstance vkInstance = VK_NULL_HANDLE;
 			VkDebugUtilsMessengerEXT vkDebugMessenger = VK_NULL_HANDLE;
 
 			VkPhysicalDevice vkPhysicalDevice = VK_NULL_HANDLE;
 			VkDevice vkDevice = VK_NULL_HANDLE;
 
+			CapabilityRequest capabilityRequest;
+			RendererCapabilities capabilities;
+
+			BeFrameCapture::FrameSink captureSink;
+			bool captureLossless = false;
+			BeFrameCapture capture;
+			PFN_vkWaitForPresentKHR vkWaitForPresent = nullptr;
+
 			VkQueue graphicsQueue = VK_NULL_HANDLE;
 			VkQueue presentQueue = VK_NULL_HANDLE;
+			VkQueue transferQueue = VK_NULL_HANDLE;
 			VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 
 			VkSurfaceKHR vkSurface = VK_NULL_HANDLE;
@@ -137,32 +289,106 @@ namespace be
 			VkFormat swapChainImageFormat;
 			VkExtent2D swapChainExtent;
 
-			VkRenderPass vkRenderPass = VK_NULL_HANDLE;
+			BeRenderGraph graph;
+			BeRenderGraph::Resource backbuffer = 0;
+			BeRenderGraph::Pass scenePass = 0;
+			VkPipelineCache vkPipelineCache = VK_NULL_HANDLE;
+			bool pipelineCacheWarm = false;
+			// Loaded ahead of the pipeline on the startup worker
+			VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+			VkShaderModule fragShaderModule = VK_NULL_HANDLE;
 			VkPipeline vkGraphicsPipeline = VK_NULL_HANDLE;
 			VkPipelineLayout vkPipelineLayout = VK_NULL_HANDLE;
 			VkCommandPool commandPool;
 
-			VkBuffer vertexBuffer;
+			BeAssetPack assets;
+			BeAllocator allocator;
+			BeStagingRing staging;
+
+			VkBuffer vertexBuffer = VK_NULL_HANDLE;
+			Allocation vertexBufferAllocation;
+			VkBuffer indexBuffer = VK_NULL_HANDLE;
+			Allocation indexBufferAllocation;
+
+			BeQuadBatch batch;
+			::std::vector<VkBuffer> instanceBuffers;
+			::std::vector<Allocation> instanceAllocations;
+			::std::vector<size_t> instanceCapacities;
+			::std::vector<uint32_t> instanceCounts;
+			::std::vector<VkBuffer> indirectBuffers;
+			::std::vector<Allocation> indirectAllocations;
+			::std::vector<uint32_t> drawCounts;
+
+			struct CachedCommandBuffer
+			{
+				VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+				bool dirty = true;
+				uint32_t drawScopes = 0;
+			};
 
+			LatencyMode latencyMode = LatencyMode::Balanced;
+			uint32_t framesInFlight = 2;
 			uint32_t currentFrame = 0;
-			::std::vector<VkCommandBuffer> commandBuffers;
+			// Indexed by frame in flight * image count + image index, only re-recorded when dirty
+			::std::vector<CachedCommandBuffer> cachedCommandBuffers;
+			::std::vector<VkCommandBuffer> acquireCommandBuffers;
+			uint64_t recordedCommandBuffers = 0;
+
+			uint32_t recordThreads = 0;
+			BeJobSystem* jobs = nullptr;
+			BeParallelRecorder recorder;
 
 			::std::vector<VkSemaphore> imageAvailableSemaphores;
 			::std::vector<VkSemaphore> renderFinishedSemaphores;
+			// One of the two tracks when each frame finished
 			::std::vector<VkFence> inFlightFences;
+			VkSemaphore frameTimeline = VK_NULL_HANDLE;
+			// Number of the frame last submitted with each in flight fence, frames are numbered from 1 in submit order
+			::std::vector<uint64_t> frameNumbers;
+			uint64_t submittedFrames = 0;
+			uint64_t completedFrames = 0;
+
+			// Deletion queue for what a swapchain rebuild replaced, destroyed once the given frame has completed
+			struct RetiredSwapChain
+			{
+				uint64_t frame = 0;
+				VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+				::std::vector<VkImage> offscreenImages;
+				::std::vector<Allocation> offscreenImageAllocations;
+				::std::vector<VkImageView> imageViews;
+				RenderGraphObjects graph;
+				::std::vector<VkCommandBuffer> commandBuffers;
+				::std::vector<VkCommandPool> commandPools;
+			};
+
+			::std::deque<RetiredSwapChain> retiredSwapChains;
+
+			BeProfiler profiler;
+
+			::std::chrono::steady_clock::time_point startupOrigin;
+			::std::vector<StartupStage> startupStages;
+			double startupMs = 0.0;
+			double firstPresentMs = -1.0;
+
+			// Presents with an input behind them whose display time hasn't been seen yet, oldest first
+			struct PendingPresent
+			{
+				uint64_t presentId;
+				InputTimestamp input;
+			};
+
+			uint64_t nextPresentId = 1;
+			::std::deque<PendingPresent> pendingPresents;
+			BeLatencyHistogram presentLatency;
+			BeLatencyHistogram displayLatency;
 
 			::std::vector<VkImage> swapChainImages;
 			::std::vector<VkImageView> swapChainImageViews;
-			::std::vector<VkFramebuffer> swapChainFramebuffers;
 
 			const ::std::vector<const char*> validationLayers = {
 				"VK_LAYER_KHRONOS_validation"
 			};
 
-			const ::std::vector<const char*> deviceExtensions = {
-				VK_KHR_SWAPCHAIN_EXTENSION_NAME
-			};
-
 			static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 				VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
 				VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -0,0 +1,133 @@
+#include "be_replay.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace be {
+
+	static const char INPUT_LOG_MAGIC[4] = { 'B', 'E', 'I', 'N' };
+
+	static InputLogHeader readHeader(std::ifstream& file, const std::string& path)
+	{
+		InputLogHeader header = {};
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			throw std::runtime_error("Input log too small: " + path);
+
+		if (memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) != 0)
+			throw std::runtime_error("Not an input log: " + path);
+		if (header.version != BeInputRecorder::VERSION)
+			throw std::runtime_error("Unsupported input log version: " + path);
+		if (header.tickRate != BePongSim::TICK_RATE)
+			throw std::runtime_error("Input log recorded at another tick rate: " + path);
+
+		return header;
+	}
+
+	static InputLogSettings settingsOf(const InputLogHeader& header)
+	{
+		InputLogSettings settings;
+		settings.seed = header.seed;
+		settings.balls = header.balls;
+		settings.ballCollisions = (header.flags & BeInputRecorder::FLAG_BALL_COLLISIONS) != 0;
+		return settings;
+	}
+
+	void BeInputRecorder::open(const std::string& path, const InputLogSettings& settings)
+	{
+		file.open(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			throw std::runtime_error("Failed to create input log: " + path);
+
+		InputLogHeader header = {};
+		memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+		header.version = VERSION;
+		header.seed = settings.seed;
+		header.balls = settings.balls;
+		header.flags = settings.ballCollisions ? FLAG_BALL_COLLISIONS : 0;
+		header.tickRate = BePongSim::TICK_RATE;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		frames = 0;
+		ticks = 0;
+	}
+
+	void BeInputRecorder::close()
+	{
+		if (file.is_open())
+			file.close();
+	}
+
+	void BeInputRecorder::key(uint32_t tick, const KeyEvent& event)
+	{
+		InputLogRecord record = { tick, RECORD_KEY, event.key, static_cast<uint8_t>(event.down ? 1 : 0), 0 };
+		file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	}
+
+	void BeInputRecorder::frame(uint32_t tick, uint32_t micros, const uint32_t* hashes, uint32_t ticks)
+	{
+		InputLogRecord record = { tick, RECORD_FRAME, 0, static_cast<uint8_t>(ticks), 0 };
+		file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+		file.write(reinterpret_cast<const char*>(&micros), sizeof(micros));
+		file.write(reinterpret_cast<const char*>(hashes), ticks * sizeof(uint32_t));
+
+		frames++;
+		this->ticks += ticks;
+	}
+
+	InputLogSettings BeInputLog::readSettings(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("Failed to open input log: " + path);
+
+		return settingsOf(readHeader(file, path));
+	}
+
+	void BeInputLog::load(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("Failed to open input log: " + path);
+
+		settings = settingsOf(readHeader(file, path));
+		keys.clear();
+		hashes.clear();
+		frames.clear();
+
+		uint32_t frameKeys = 0;
+		InputLogRecord record;
+		while (file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+		{
+			if (record.type == BeInputRecorder::RECORD_KEY)
+			{
+				keys.push_back({ record.tick, { record.key, record.value != 0 } });
+				frameKeys++;
+				continue;
+			}
+
+			if (record.type != BeInputRecorder::RECORD_FRAME || record.value > BePongSim::MAX_TICKS_PER_ADVANCE)
+				throw std::runtime_error("Corrupt input log: " + path);
+
+			Frame frame = {};
+			frame.tick = record.tick;
+			frame.firstKey = static_cast<uint32_t>(keys.size()) - frameKeys;
+			frame.keyCount = frameKeys;
+			frame.firstHash = static_cast<uint32_t>(hashes.size());
+			frame.tickCount = record.value;
+
+			hashes.resize(hashes.size() + frame.tickCount);
+			if (!file.read(reinterpret_cast<char*>(&frame.micros), sizeof(frame.micros)) ||
+				!file.read(reinterpret_cast<char*>(hashes.data() + frame.firstHash), frame.tickCount * sizeof(uint32_t)))
+			{
+				throw std::runtime_error("Truncated input log: " + path);
+			}
+
+			frames.push_back(frame);
+			frameKeys = 0;
+		}
+
+		// Keys after the last frame were never seen by a tick, a partial record means the file was cut off
+		if (file.gcount() != 0)
+			throw std::runtime_error("Truncated input log: " + path);
+	}
+}
\ No newline at end of file
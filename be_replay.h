@@ -0,0 +1,126 @@
+#pragma once
+
+#include "be_window.h"
+#include "be_pong.h"
+#include "be_balls.h"
+
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace be
+{
+	// On disk layout, little endian. The header is followed by records: key events, and frames whose record is
+	// followed by the frame's elapsed microseconds and one state hash per tick it ran.
+	struct InputLogHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t seed;
+		uint32_t balls;
+		uint32_t flags;
+		uint32_t tickRate;
+	};
+
+	struct InputLogRecord
+	{
+		// Key events: the first tick that sees them. Frames: the tick their first tick starts from.
+		uint32_t tick;
+		uint8_t type;
+		uint8_t key;
+		// Key events: pressed or released. Frames: ticks run.
+		uint8_t value;
+		uint8_t reserved;
+	};
+
+	static_assert(sizeof(InputLogHeader) == 24, "input log header layout");
+	static_assert(sizeof(InputLogRecord) == 8, "input log record layout");
+
+	// Everything besides the input that decides how a match plays out
+	struct InputLogSettings
+	{
+		uint32_t seed = 1;
+		uint32_t balls = 0;
+		bool ballCollisions = false;
+	};
+
+	// What the log keeps per tick, enough to notice a replay leaving the recorded path: the game, every extra ball and
+	// the number of ball pairs that collided
+	inline uint32_t tickHash(const PongState& state, const BeBallField& balls, uint32_t collisionPairs)
+	{
+		uint64_t hash = hashPongState(state);
+		for (uint64_t part : { hashBallField(balls), static_cast<uint64_t>(collisionPairs) })
+		{
+			hash ^= part + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+			hash *= 1099511628211ull;
+		}
+		return static_cast<uint32_t>(hash ^ (hash >> 32));
+	}
+
+	// Writes the key events a match consumed, stamped with the tick that first saw them, and the tickHash after
+	// every tick
+	class BeInputRecorder
+	{
+	public:
+		static constexpr uint32_t VERSION = 2;
+		static constexpr uint32_t FLAG_BALL_COLLISIONS = 1;
+		static constexpr uint8_t RECORD_KEY = 0;
+		static constexpr uint8_t RECORD_FRAME = 1;
+
+		void open(const ::std::string& path, const InputLogSettings& settings);
+		void close();
+		bool isOpen() const { return file.is_open(); }
+
+		// Key events go in before the frame whose ticks see them
+		void key(uint32_t tick, const KeyEvent& event);
+		void frame(uint32_t tick, uint32_t micros, const uint32_t* hashes, uint32_t ticks);
+
+		uint64_t getFrames() const { return frames; }
+		uint64_t getTicks() const { return ticks; }
+
+	private:
+		::std::ofstream file;
+		uint64_t frames = 0;
+		uint64_t ticks = 0;
+	};
+
+	// A recorded match, read back whole. Keys and hashes are kept in one array each and frames index into them.
+	class BeInputLog
+	{
+	public:
+		struct Key
+		{
+			uint32_t tick;
+			KeyEvent event;
+		};
+
+		struct Frame
+		{
+			uint32_t tick;
+			uint32_t micros;
+			uint32_t firstKey;
+			uint32_t keyCount;
+			uint32_t firstHash;
+			uint32_t tickCount;
+		};
+
+		// Throws if the file is missing, truncated or from another version
+		void load(const ::std::string& path);
+		// Only the header, so options can follow the log before anything is created
+		static InputLogSettings readSettings(const ::std::string& path);
+
+		const InputLogSettings& getSettings() const { return settings; }
+		const ::std::vector<Frame>& getFrames() const { return frames; }
+		const Key* getKeys(const Frame& frame) const { return keys.data() + frame.firstKey; }
+		const uint32_t* getHashes(const Frame& frame) const { return hashes.data() + frame.firstHash; }
+		uint64_t getTickCount() const { return hashes.size(); }
+
+	private:
+		InputLogSettings settings;
+		::std::vector<Key> keys;
+		::std::vector<uint32_t> hashes;
+		::std::vector<Frame> frames;
+	};
+}
\ No newline at end of file
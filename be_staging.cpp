@@ -0,0 +1,211 @@
+#include "be_staging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace be {
+	namespace renderer {
+
+		void BeStagingRing::init(VkDevice device, BeAllocator* allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily, uint32_t framesInFlight)
+		{
+			this->device = device;
+			this->allocator = allocator;
+			this->transferQueue = transferQueue;
+			this->transferFamily = transferFamily;
+			this->graphicsFamily = graphicsFamily;
+
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = transferFamily;
+
+			if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+				throw std::runtime_error("failed to create transfer command pool");
+
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = REGION_SIZE * framesInFlight;
+			bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingAllocation);
+
+			regions.resize(framesInFlight);
+			for (auto& region : regions)
+			{
+				VkCommandBufferAllocateInfo allocInfo = {};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.commandPool = commandPool;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandBufferCount = 1;
+
+				if (vkAllocateCommandBuffers(device, &allocInfo, &region.commandBuffer) != VK_SUCCESS)
+					throw std::runtime_error("failed to allocate transfer command buffer");
+
+				VkSemaphoreCreateInfo semaphoreInfo = {};
+				semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+				if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &region.uploadFinished) != VK_SUCCESS)
+					throw std::runtime_error("failed to create upload semaphore");
+			}
+
+			current = 0;
+		}
+
+		void BeStagingRing::destroy()
+		{
+			if (device == VK_NULL_HANDLE)
+				return;
+
+			for (auto& region : regions)
+				vkDestroySemaphore(device, region.uploadFinished, nullptr);
+			regions.clear();
+
+			vkDestroyCommandPool(device, commandPool, nullptr);
+			allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+		}
+
+		void BeStagingRing::beginFrame(uint32_t frameIndex)
+		{
+			current = frameIndex;
+
+			// Writes queued before the region was ever flushed (e.g. during init) must survive
+			Region& region = regions[frameIndex];
+			if (region.submitted)
+			{
+				region.head = 0;
+				region.submitted = false;
+				region.flushed.clear();
+			}
+		}
+
+		void* BeStagingRing::write(VkBuffer dst, VkDeviceSize dstOffset, VkDeviceSize size)
+		{
+			Region& region = regions[current];
+			if (region.submitted)
+				throw std::runtime_error("staging write after the frame was flushed, upload between beginFrame and flush");
+
+			VkDeviceSize offset = (region.head + WRITE_ALIGNMENT - 1) / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+			if (offset + size > REGION_SIZE)
+				throw std::runtime_error("staging ring overflow, too much data uploaded in one frame");
+
+			region.head = offset + size;
+
+			Copy copy;
+			copy.dst = dst;
+			copy.region.srcOffset = REGION_SIZE * current + offset;
+			copy.region.dstOffset = dstOffset;
+			copy.region.size = size;
+			region.pending.push_back(copy);
+
+			return static_cast<char*>(stagingAllocation.mapped) + copy.region.srcOffset;
+		}
+
+		void BeStagingRing::write(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+		{
+			memcpy(write(dst, dstOffset, size), data, static_cast<size_t>(size));
+		}
+
+		VkSemaphore BeStagingRing::flush(uint32_t frameIndex)
+		{
+			Region& region = regions[frameIndex];
+			if (region.pending.empty())
+				return VK_NULL_HANDLE;
+
+			// Group copies per destination so each buffer gets a single vkCmdCopyBuffer
+			std::stable_sort(region.pending.begin(), region.pending.end(), [](const Copy& a, const Copy& b) { return a.dst < b.dst; });
+
+			vkResetCommandBuffer(region.commandBuffer, 0);
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+			if (vkBeginCommandBuffer(region.commandBuffer, &beginInfo) != VK_SUCCESS)
+				throw std::runtime_error("Failed to begin recording transfer command buffer");
+
+			std::vector<VkBufferCopy> regionsForDst;
+			std::vector<VkBufferMemoryBarrier> releases;
+
+			for (size_t i = 0; i < region.pending.size();)
+			{
+				VkBuffer dst = region.pending[i].dst;
+
+				regionsForDst.clear();
+				for (; i < region.pending.size() && region.pending[i].dst == dst; i++)
+					regionsForDst.push_back(region.pending[i].region);
+
+				vkCmdCopyBuffer(region.commandBuffer, stagingBuffer, dst, static_cast<uint32_t>(regionsForDst.size()), regionsForDst.data());
+
+				if (hasDedicatedQueue())
+				{
+					VkBufferMemoryBarrier release = {};
+					release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					release.dstAccessMask = 0;
+					release.srcQueueFamilyIndex = transferFamily;
+					release.dstQueueFamilyIndex = graphicsFamily;
+					release.buffer = dst;
+					release.offset = 0;
+					release.size = VK_WHOLE_SIZE;
+					releases.push_back(release);
+				}
+			}
+
+			if (!releases.empty())
+			{
+				vkCmdPipelineBarrier(region.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+					0, nullptr, static_cast<uint32_t>(releases.size()), releases.data(), 0, nullptr);
+			}
+
+			if (vkEndCommandBuffer(region.commandBuffer) != VK_SUCCESS)
+				throw std::runtime_error("Failed to end transfer command buffer");
+
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &region.commandBuffer;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &region.uploadFinished;
+
+			// No fence: the graphics submission waits on uploadFinished, so its in flight fence covers this batch too
+			if (vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+				throw std::runtime_error("failed to submit upload command buffer!");
+
+			region.flushed.swap(region.pending);
+			region.pending.clear();
+			region.submitted = true;
+
+			return region.uploadFinished;
+		}
+
+		void BeStagingRing::cmdAcquire(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+		{
+			Region& region = regions[frameIndex];
+			if (!hasDedicatedQueue() || region.flushed.empty())
+				return;
+
+			std::vector<VkBufferMemoryBarrier> acquires;
+			for (const auto& copy : region.flushed)
+			{
+				if (!acquires.empty() && acquires.back().buffer == copy.dst)
+					continue;
+
+				VkBufferMemoryBarrier acquire = {};
+				acquire.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				acquire.srcAccessMask = 0;
+				acquire.dstAccessMask = CONSUMER_ACCESS;
+				acquire.srcQueueFamilyIndex = transferFamily;
+				acquire.dstQueueFamilyIndex = graphicsFamily;
+				acquire.buffer = copy.dst;
+				acquire.offset = 0;
+				acquire.size = VK_WHOLE_SIZE;
+				acquires.push_back(acquire);
+			}
+
+			vkCmdPipelineBarrier(commandBuffer, CONSUMER_STAGES, CONSUMER_STAGES, 0,
+				0, nullptr, static_cast<uint32_t>(acquires.size()), acquires.data(), 0, nullptr);
+		}
+	}
+}
\ No newline at end of file
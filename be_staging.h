@@ -0,0 +1,79 @@
+#pragma once
+
+#include "be_allocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace be
+{
+	namespace renderer {
+
+		// Persistently mapped staging memory split into one region per frame in flight. Writes made during a frame
+		// are turned into buffer copies and submitted as a single batch on the transfer queue by flush(). A region is
+		// only reused once the frame that consumed it has passed its in flight fence.
+		class BeStagingRing
+		{
+		public:
+			static constexpr VkDeviceSize REGION_SIZE = 8ull * 1024 * 1024;
+			static constexpr VkDeviceSize WRITE_ALIGNMENT = 16;
+
+			// Stages that consume uploaded data, the graphics submission waits on the upload semaphore there
+			static constexpr VkPipelineStageFlags CONSUMER_STAGES = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+			static constexpr VkAccessFlags CONSUMER_ACCESS = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+			void init(VkDevice device, BeAllocator* allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily, uint32_t framesInFlight);
+			void destroy();
+
+			// Call right after the frame's in flight fence has been waited on
+			void beginFrame(uint32_t frameIndex);
+
+			// Returns mapped memory that will be copied into dst at dstOffset when the frame is flushed. Only valid
+			// between beginFrame and flush. dst must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+			void* write(VkBuffer dst, VkDeviceSize dstOffset, VkDeviceSize size);
+			void write(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+			// Submits all pending copies of the frame on the transfer queue. Returns the semaphore the graphics
+			// submission has to wait on at CONSUMER_STAGES, or VK_NULL_HANDLE if nothing was uploaded.
+			VkSemaphore flush(uint32_t frameIndex);
+
+			// Records the queue family ownership acquire for the buffers flushed this frame, outside of a render pass
+			void cmdAcquire(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+			bool hasPendingAcquire(uint32_t frameIndex) const { return hasDedicatedQueue() && !regions[frameIndex].flushed.empty(); }
+
+			bool hasDedicatedQueue() const { return transferFamily != graphicsFamily; }
+
+		private:
+			struct Copy
+			{
+				VkBuffer dst;
+				VkBufferCopy region;
+			};
+
+			struct Region
+			{
+				VkDeviceSize head = 0;
+				bool submitted = false;
+				::std::vector<Copy> pending;
+				::std::vector<Copy> flushed;
+
+				VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+				VkSemaphore uploadFinished = VK_NULL_HANDLE;
+			};
+
+			VkDevice device = VK_NULL_HANDLE;
+			BeAllocator* allocator = nullptr;
+			VkQueue transferQueue = VK_NULL_HANDLE;
+			uint32_t transferFamily = 0;
+			uint32_t graphicsFamily = 0;
+
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			VkBuffer stagingBuffer = VK_NULL_HANDLE;
+			Allocation stagingAllocation;
+
+			::std::vector<Region> regions;
+			uint32_t current = 0;
+		};
+	}
+}
\ No newline at end of file
@@ -2,6 +2,24 @@
 
 #include <stdexcept>
 
+namespace be {
+
+	void handleKeyEvent(uint8_t key, bool down)
+	{
+		// Auto repeat doesn't change anything the game sees, so it is neither an input to measure nor one to record
+		if (::g_keys[key] == down)
+			return;
+
+		if (::g_inputTime == 0)
+			::g_inputTime = inputTimestampNow();
+		if (::g_keyLog != nullptr)
+			::g_keyLog->push_back({ key, down });
+		::g_keys[key] = down;
+	}
+}
+
+#ifdef _WIN32
+
 namespace be {
 
 
@@ -60,6 +78,10 @@ LRESULT CALLBACK windProc(HWND wnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	case WM_SIZE:
 		::g_resized = true;
 		break;
+	case WM_KEYDOWN:
+	case WM_KEYUP:
+		be::handleKeyEvent(static_cast<uint8_t>(wParam & 0xFF), msg == WM_KEYDOWN);
+		break;
 	default:
 		res = DefWindowProc(wnd, msg, wParam, lParam);
 		break;
@@ -68,3 +90,19 @@ LRESULT CALLBACK windProc(HWND wnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	return res;
 
 }
+
+#else
+
+namespace be {
+
+	void initWindow(BeWindow&, int, int, std::string)
+	{
+		throw std::runtime_error("Windowed mode is only supported on Win32, use headless mode");
+	}
+
+	void BeWindow::handleMessages()
+	{
+	}
+}
+
+#endif
\ No newline at end of file
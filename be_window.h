@@ -1,14 +1,41 @@
 #pragma once
 
+#ifdef _WIN32
 #define NOMINMAX
 #include <Windows.h>
+#endif
+
+#include "be_latency.h"
 
 #include<string>
+#include <cstdint>
+#include <vector>
+
+namespace be {
+
+	// A key press or release that changed the key's state
+	struct KeyEvent
+	{
+		uint8_t key;
+		bool down;
+	};
+
+	// Every key transition goes through here, from windProc as well as from a replayed input log
+	void handleKeyEvent(uint8_t key, bool down);
+}
 
 inline bool g_running = false;
 inline bool g_resized = false;
-
+// Pressed state per virtual key code, updated by handleKeyEvent
+inline bool g_keys[256] = {};
+// Oldest key press or release not yet handed to the simulation, stamped by windProc as the message is dispatched
+inline be::InputTimestamp g_inputTime = 0;
+// Collects the key transitions handleKeyEvent sees while input is being recorded, null otherwise
+inline std::vector<be::KeyEvent>* g_keyLog = nullptr;
+
+#ifdef _WIN32
 LRESULT CALLBACK windProc(HWND wnd, UINT msg, WPARAM wParam, LPARAM lParam);
+#endif
 
 
 namespace be {
@@ -19,7 +46,9 @@ namespace be {
 		int height;
 		std::string windowName;
 
+#ifdef _WIN32
 		HWND window = {};
+#endif
 
 		void handleMessages();
 	};
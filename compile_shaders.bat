@@ -1,2 +1,3 @@
 glslc shaders\shader.vert -o shaders\vert.spv
 glslc shaders\shader.frag -o shaders\frag.spv
+python tools\pack_assets.py -o "%~1assets.pack" shaders/vert.spv=shaders\vert.spv shaders/frag.spv=shaders\frag.spv
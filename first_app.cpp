@@ -1,13 +1,1042 @@
 #include "first_app.h"
+#include "be_raster.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 namespace be {
 
+	AppOptions parseOptions(int argc, char** argv)
+	{
+		AppOptions options;
+
+		for (int i = 1; i < argc; i++)
+		{
+			bool hasValue = i + 1 < argc;
+
+			if (strcmp(argv[i], "--headless") == 0)
+				options.headless = true;
+			else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+				options.frames = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--width") == 0 && hasValue)
+				options.width = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--height") == 0 && hasValue)
+				options.height = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--images") == 0 && hasValue)
+				options.imageCount = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--record-threads") == 0 && hasValue)
+				options.recordThreads = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--bench-record") == 0)
+				options.benchRecord = options.headless = true;
+			else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+				options.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+			else if (strcmp(argv[i], "--sim-ticks") == 0 && hasValue)
+				options.simTicks = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+			else if (strcmp(argv[i], "--balls") == 0 && hasValue)
+				options.balls = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+			else if (strcmp(argv[i], "--bench-balls") == 0)
+				options.benchBalls = true;
+			else if (strcmp(argv[i], "--simd") == 0 && hasValue)
+			{
+				std::string name = argv[++i];
+				SimdLevel level = name == "avx2" ? SimdLevel::AVX2 : (name == "sse2" ? SimdLevel::SSE2 : SimdLevel::Scalar);
+				if (name != simdLevelName(level))
+					throw std::runtime_error("Unknown SIMD level: " + name);
+				if (level > options.simd)
+					throw std::runtime_error("SIMD level not supported by this CPU: " + name);
+				options.simd = level;
+			}
+			else if (strcmp(argv[i], "--collide") == 0)
+				options.ballCollisions = true;
+			else if (strcmp(argv[i], "--jobs") == 0 && hasValue)
+				options.jobThreads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+			else if (strcmp(argv[i], "--bench-jobs") == 0)
+				options.benchJobs = true;
+			else if (strcmp(argv[i], "--bench-grid") == 0)
+				options.benchGrid = true;
+			else if (strcmp(argv[i], "--pipeline") == 0 && hasValue)
+				options.pipelineDepth = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+			else if (strcmp(argv[i], "--latency") == 0 && hasValue)
+			{
+				std::string name = argv[++i];
+				renderer::LatencyMode mode = name == "low" ? renderer::LatencyMode::LowLatency
+					: (name == "throughput" ? renderer::LatencyMode::Throughput : renderer::LatencyMode::Balanced);
+				if (name != renderer::latencyModeName(mode))
+					throw std::runtime_error("Unknown latency mode: " + name);
+				options.latency = mode;
+			}
+			else if (strcmp(argv[i], "--render-pass") == 0)
+				options.dynamicRendering = false;
+			else if (strcmp(argv[i], "--fences") == 0)
+				options.timelineSync = false;
+			else if (strcmp(argv[i], "--record") == 0 && hasValue)
+				options.recordPath = argv[++i];
+			else if (strcmp(argv[i], "--replay") == 0 && hasValue)
+				options.replayPath = argv[++i];
+			else if (strcmp(argv[i], "--real-time") == 0)
+				options.replayRealTime = true;
+			else if (strcmp(argv[i], "--capture") == 0 && hasValue)
+				options.captureDirectory = argv[++i];
+			else if (strcmp(argv[i], "--capture-raw") == 0)
+				options.captureRaw = true;
+			else if (strcmp(argv[i], "--regress") == 0 && hasValue)
+				options.regressDirectory = argv[++i];
+			else if (strcmp(argv[i], "--regress-results") == 0 && hasValue)
+				options.regressResults = argv[++i];
+			else if (strcmp(argv[i], "--regress-update") == 0)
+				options.regressUpdate = true;
+			else if (strcmp(argv[i], "--regress-reference") == 0)
+				options.regressReference = true;
+			else if (strcmp(argv[i], "--stress") == 0)
+				options.stressQuads = hasValue && isdigit(static_cast<unsigned char>(argv[i + 1][0])) ? static_cast<uint32_t>(atoi(argv[++i])) : 100000;
+			else
+				throw std::runtime_error(std::string("Unknown option: ") + argv[i]);
+		}
+
+		if (options.width == 0 || options.height == 0 || options.imageCount == 0)
+			throw std::runtime_error("Headless extent and image count must be non zero");
+
+		if (!options.recordPath.empty() && (options.headless || !options.replayPath.empty()))
+			throw std::runtime_error("Only windowed matches have input to record");
+
+		if (!options.replayPath.empty())
+		{
+			InputLogSettings settings = BeInputLog::readSettings(options.replayPath);
+			options.seed = settings.seed;
+			options.balls = settings.balls;
+			options.ballCollisions = settings.ballCollisions;
+			options.headless = true;
+		}
+
+		if (!options.regressDirectory.empty())
+		{
+			if (!options.recordPath.empty() || !options.replayPath.empty())
+				throw std::runtime_error("The regression run plays its own scripted scenes");
+			options.headless = true;
+		}
+		else if (options.regressUpdate || options.regressReference || !options.regressResults.empty())
+			throw std::runtime_error("--regress-update, --regress-reference and --regress-results need --regress");
+
+		return options;
+	}
+
+	FirstApp::~FirstApp()
+	{
+		if (renderer == nullptr)
+			return;
+
+		renderer->waitIdle();
+
+		if (inputRecorder.isOpen())
+		{
+			::g_keyLog = nullptr;
+			std::cout << "input log: " << inputRecorder.getFrames() << " frames, " << inputRecorder.getTicks() << " ticks written to " << options.recordPath << std::endl;
+			inputRecorder.close();
+		}
+
+		renderer->getProfiler().dump(std::cout);
+
+		auto memory = renderer->getAllocatorStats();
+		std::cout << "device memory: " << memory.deviceAllocations << "/" << memory.maxDeviceAllocations << " allocations, "
+			<< memory.usedBytes << "/" << memory.reservedBytes << " bytes used, " << memory.totalAllocations << " suballocations" << std::endl;
+		VkDeviceSize budgetUsage, budget;
+		renderer->getDeviceLocalBudget(budgetUsage, budget);
+		if (budget > 0)
+			std::cout << "device local heaps: " << budgetUsage << "/" << budget << " bytes of budget used" << std::endl;
+		if (renderer->isCapturing())
+		{
+			const auto& capture = renderer->getCapture();
+			std::cout << "capture: " << capture.getCapturedFrames() << " frames to " << options.captureDirectory << ", "
+				<< capture.getDroppedFrames() << " dropped while the writer was behind" << std::endl;
+		}
+		std::cout << "command buffers recorded: " << renderer->getRecordedCommandBuffers() << " over " << frameCount << " frames" << std::endl;
+
+		if (renderer->getPresentLatency().count() > 0)
+		{
+			renderer->getPresentLatency().dump(std::cout, "input to present");
+			if (renderer->hasPresentWait())
+				renderer->getDisplayLatency().dump(std::cout, "input to display");
+		}
+
+		renderer.reset();
+	}
+
 	void FirstApp::run()
 	{
+		if (options.simTicks > 0)
+		{
+			runSimulation();
+			return;
+		}
+
+		if (options.benchBalls)
+		{
+			runBallBenchmark();
+			return;
+		}
+
+		if (options.benchGrid)
+		{
+			runGridBenchmark();
+			return;
+		}
+
+		if (options.benchJobs)
+		{
+			runJobBenchmark();
+			return;
+		}
+
+		if (options.benchRecord)
+		{
+			runRecordBenchmark();
+			return;
+		}
+
+		if (!options.replayPath.empty())
+		{
+			runReplay();
+			return;
+		}
+
+		if (!options.regressDirectory.empty())
+		{
+			runRegression();
+			return;
+		}
+
+		if (options.pipelineDepth > 0)
+		{
+			runPipelined();
+			return;
+		}
+
+		if (options.headless)
+		{
+			runHeadless();
+			return;
+		}
+
+		auto last = std::chrono::steady_clock::now();
+
 		while (::g_running) {
+			// In low latency mode input is sampled once the frame slot is free, right before the frame is built and
+			// recorded, instead of a frame's worth of GPU time earlier
+			if (renderer->getLatencyMode() == renderer::LatencyMode::LowLatency)
+				renderer->waitForFrame();
+
 			window.handleMessages();
+			pollLatencyKeys();
+			publishInput();
+
+			auto now = std::chrono::steady_clock::now();
+			InputTimestamp input = simulateFrame(std::chrono::duration<double>(now - last).count());
+			last = now;
+
+			buildScene(renderer->getBatch());
+			renderer->drawFrame(input);
+		}
+	}
+
+	void FirstApp::runHeadless()
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < options.frames; i++)
+		{
+			simulateFrame(0.0);
+			buildScene(renderer->getBatch());
+			renderer->drawFrame();
+		}
+
+		renderer->waitIdle();
+		reportFrames(options.frames, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	void FirstApp::runReplay()
+	{
+		BeInputLog log;
+		log.load(options.replayPath);
+
+		auto start = std::chrono::steady_clock::now();
+		auto due = start;
+		uint32_t frames = 0;
+
+		for (const auto& frame : log.getFrames())
+		{
+			if (frame.tick != sim.current().tick)
+				throw std::runtime_error("Input log frame starts at tick " + std::to_string(frame.tick) + ", replay is at tick " + std::to_string(sim.current().tick));
+
+			// Through the same key handling and input sampling as the window's events
+			const BeInputLog::Key* keys = log.getKeys(frame);
+			for (uint32_t i = 0; i < frame.keyCount; i++)
+			{
+				if (keys[i].tick != frame.tick)
+					throw std::runtime_error("Input log key event stamped for tick " + std::to_string(keys[i].tick) + " inside a frame at tick " + std::to_string(frame.tick));
+				handleKeyEvent(keys[i].event.key, keys[i].event.down);
+			}
+			publishInput();
+			// Nothing to measure latency against, the events never came from a window
+			pendingInput.store(0);
+			PongInput input = readInput();
+
+			const uint32_t* hashes = log.getHashes(frame);
+			for (uint32_t t = 0; t < frame.tickCount; t++)
+			{
+				sim.step(input);
+				stepBalls();
+				if (tickHash(sim.current(), balls, static_cast<uint32_t>(ballPairs.size())) != hashes[t])
+					throw std::runtime_error("Replay diverged from the recording at tick " + std::to_string(sim.current().tick));
+			}
+
+			if (options.replayRealTime)
+			{
+				due += std::chrono::microseconds(frame.micros);
+				std::this_thread::sleep_until(due);
+			}
+
+			buildScene(renderer->getBatch());
 			renderer->drawFrame();
+			frames++;
 		}
+
+		renderer->waitIdle();
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double simulated = log.getTickCount() * BePongSim::TICK_SECONDS;
+		reportFrames(frames, seconds);
+		std::cout << "replay: " << log.getTickCount() << " ticks verified (" << simulated << "s of game time) in " << seconds << "s, "
+			<< (seconds > 0.0 ? simulated / seconds : 0.0) << "x real time" << std::endl;
+	}
+
+	// A scripted scene of the regression run. Going over any threshold fails the run.
+	struct RegressionScene
+	{
+		const char* name;
+		uint32_t frames;
+		uint32_t balls;
+		bool ballCollisions;
+		uint32_t stressQuads;
+
+		double maxFrameMs;
+		double maxStartupMs;
+		uint32_t maxDeviceAllocations;
+		// Channel difference a pixel may have from the golden image, and the share of pixels allowed to go beyond it
+		uint32_t pixelTolerance;
+		double maxMismatchedShare;
+	};
+
+	// Sized for a software device, the goldens are rendered at this extent
+	static const RegressionScene REGRESSION_SCENES[] = {
+		{ "pong", 120, 0, false, 0, 20.0, 5000.0, 16, 2, 0.001 },
+		{ "balls", 120, 2000, true, 0, 40.0, 5000.0, 16, 2, 0.001 },
+		{ "stress", 30, 0, false, 20000, 100.0, 5000.0, 16, 2, 0.001 },
+	};
+	static const VkExtent2D REGRESSION_EXTENT = { 320, 240 };
+	static const uint32_t REGRESSION_IMAGES = 3;
+	// Fixed rather than --seed, the goldens only hold for this one
+	static const uint32_t REGRESSION_SEED = 1;
+
+	static std::string jsonString(const std::string& value)
+	{
+		std::string quoted = "\"";
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+				quoted += '\\';
+			if (static_cast<unsigned char>(c) >= 0x20)
+				quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	void FirstApp::runRegression()
+	{
+		// Frames that don't match their golden are written next to the results, for a look or to adopt them
+		std::string resultsPath = options.regressResults.empty() ? options.regressDirectory + "/results.json" : options.regressResults;
+		std::filesystem::path outputDirectory = std::filesystem::path(resultsPath).parent_path();
+		for (const auto& directory : { outputDirectory, std::filesystem::path(options.regressUpdate ? options.regressDirectory : "") })
+		{
+			std::error_code error;
+			if (!directory.empty())
+				std::filesystem::create_directories(directory, error);
+			if (error)
+				throw std::runtime_error("Failed to create " + directory.string() + ": " + error.message());
+		}
+
+		std::ofstream results(resultsPath, std::ios::trunc);
+		if (!results.is_open())
+			throw std::runtime_error("Failed to create " + resultsPath);
+
+		std::string device;
+		bool passed = true;
+		results << "{\n\t\"scenes\": [";
+
+		for (size_t s = 0; s < std::size(REGRESSION_SCENES); s++)
+		{
+			const RegressionScene& scene = REGRESSION_SCENES[s];
+
+			// Every scene starts from the same state, whatever ran before it
+			options.balls = scene.balls;
+			options.ballCollisions = scene.ballCollisions;
+			options.stressQuads = scene.stressQuads;
+			sim = BePongSim(REGRESSION_SEED);
+			balls = BeBallField();
+			balls.spawn(scene.balls, REGRESSION_SEED);
+			ballPairs.clear();
+			frameCount = 0;
+
+			// Only the last frame is compared, frame numbers of a fresh renderer count from 1. The capture is lossless,
+			// a slow writer thread must not cost the scene its last frame.
+			std::mutex imageMutex;
+			RgbaImage image;
+			std::vector<std::string> failures;
+
+			double startupMs = 0.0, firstFrameMs = 0.0, frameMs = 0.0;
+			renderer::AllocatorStats memory;
+			if (options.regressReference)
+			{
+				// The same frames drawn on the CPU, only the image is checked. Times and allocations stay 0.
+				device = "cpu reference";
+				renderer::BeQuadBatch batch;
+				for (uint32_t i = 0; i < scene.frames; i++)
+				{
+					simulateFrame(0.0);
+					buildScene(batch);
+				}
+				image = renderer::rasterizeBatch(batch, REGRESSION_EXTENT.width, REGRESSION_EXTENT.height, renderer::SCENE_CLEAR_COLOR);
+			}
+			else
+			{
+				renderer::BeRenderer sceneRenderer(REGRESSION_EXTENT, REGRESSION_IMAGES);
+				sceneRenderer.setSoftwareRendering(true);
+				sceneRenderer.setJobSystem(&jobs);
+				sceneRenderer.setCapture([&imageMutex, &image, &scene](const renderer::BeFrameCapture::CapturedFrame& frame) {
+					if (frame.frame != scene.frames)
+						return;
+					std::lock_guard<std::mutex> lock(imageMutex);
+					image = renderer::BeFrameCapture::toRgba(frame);
+				}, true);
+				sceneRenderer.init();
+				device = sceneRenderer.getCapabilities().deviceName;
+
+				auto start = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i < scene.frames; i++)
+				{
+					simulateFrame(0.0);
+					buildScene(sceneRenderer.getBatch());
+					sceneRenderer.drawFrame();
+				}
+				sceneRenderer.waitIdle();
+
+				frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / scene.frames;
+				startupMs = sceneRenderer.getStartupMs();
+				firstFrameMs = sceneRenderer.getFirstPresentMs();
+				memory = sceneRenderer.getAllocatorStats();
+			}
+
+			// The renderer is gone and its capture thread with it. A missing golden is a failure, only --regress-update
+			// writes new ones.
+			std::string goldenPath = options.regressDirectory + "/" + scene.name + ".png";
+			std::string actualPath = (outputDirectory / (std::string(scene.name) + ".actual.png")).string();
+			std::string golden;
+			ImageDifference difference;
+			if (image.pixels.empty())
+			{
+				golden = "not captured";
+				failures.push_back("last frame wasn't captured");
+			}
+			else if (options.regressUpdate)
+			{
+				golden = "updated";
+				writePng(goldenPath, image);
+			}
+			else if (!std::filesystem::exists(goldenPath))
+			{
+				golden = "missing";
+				failures.push_back("no golden image at " + goldenPath + ", frame written to " + actualPath);
+				writePng(actualPath, image);
+			}
+			else
+			{
+				difference = compareImages(image, readPng(goldenPath), scene.pixelTolerance);
+				uint64_t allowed = static_cast<uint64_t>(scene.maxMismatchedShare * REGRESSION_EXTENT.width * REGRESSION_EXTENT.height);
+				golden = difference.mismatchedPixels > allowed ? "mismatch" : "match";
+				if (difference.mismatchedPixels > allowed)
+				{
+					failures.push_back(std::to_string(difference.mismatchedPixels) + " pixels differ from the golden image, frame written to " + actualPath);
+					writePng(actualPath, image);
+				}
+			}
+
+			if (frameMs > scene.maxFrameMs)
+				failures.push_back("frame time over " + std::to_string(scene.maxFrameMs) + " ms");
+			if (startupMs > scene.maxStartupMs)
+				failures.push_back("startup over " + std::to_string(scene.maxStartupMs) + " ms");
+			if (memory.deviceAllocations > scene.maxDeviceAllocations)
+				failures.push_back("more than " + std::to_string(scene.maxDeviceAllocations) + " device allocations");
+			passed = passed && failures.empty();
+
+			std::cout << "regress: " << scene.name << " " << (failures.empty() ? "passed" : "FAILED") << ", " << frameMs << " ms per frame, startup "
+				<< startupMs << " ms, " << memory.deviceAllocations << " device allocations, golden " << golden << std::endl;
+			for (const auto& failure : failures)
+				std::cout << "regress: " << scene.name << ": " << failure << std::endl;
+
+			results << (s > 0 ? "," : "") << "\n\t\t{\n"
+				<< "\t\t\t\"name\": " << jsonString(scene.name) << ",\n"
+				<< "\t\t\t\"passed\": " << (failures.empty() ? "true" : "false") << ",\n"
+				<< "\t\t\t\"frames\": " << scene.frames << ",\n"
+				<< "\t\t\t\"frameMs\": " << frameMs << ",\n"
+				<< "\t\t\t\"startupMs\": " << startupMs << ",\n"
+				<< "\t\t\t\"firstFrameMs\": " << firstFrameMs << ",\n"
+				<< "\t\t\t\"deviceAllocations\": " << memory.deviceAllocations << ",\n"
+				<< "\t\t\t\"suballocations\": " << memory.totalAllocations << ",\n"
+				<< "\t\t\t\"golden\": " << jsonString(golden) << ",\n"
+				<< "\t\t\t\"mismatchedPixels\": " << difference.mismatchedPixels << ",\n"
+				<< "\t\t\t\"maxChannelDifference\": " << difference.maxChannelDifference << ",\n"
+				<< "\t\t\t\"thresholds\": { \"frameMs\": " << scene.maxFrameMs << ", \"startupMs\": " << scene.maxStartupMs
+				<< ", \"deviceAllocations\": " << scene.maxDeviceAllocations << ", \"pixelTolerance\": " << scene.pixelTolerance
+				<< ", \"mismatchedShare\": " << scene.maxMismatchedShare << " },\n"
+				<< "\t\t\t\"failures\": [";
+			for (size_t f = 0; f < failures.size(); f++)
+				results << (f > 0 ? ", " : "") << jsonString(failures[f]);
+			results << "]\n\t\t}";
+		}
+
+		results << "\n\t],\n\t\"device\": " << jsonString(device) << ",\n\t\"passed\": " << (passed ? "true" : "false") << "\n}\n";
+		results.close();
+
+		std::cout << "regress: results written to " << resultsPath << std::endl;
+		if (!passed)
+			throw std::runtime_error("Regression run failed, see " + resultsPath);
+	}
+
+	void FirstApp::runPipelined()
+	{
+		// The simulation thread fills free snapshots while this thread renders ready ones, with depth snapshots in
+		// total the simulation runs at most depth - 1 frames ahead of the frame being recorded
+		snapshots = std::vector<FrameSnapshot>(options.pipelineDepth);
+		freeSnapshots.reset(snapshots.size());
+		readySnapshots.reset(snapshots.size());
+		for (auto& snapshot : snapshots)
+			freeSnapshots.push(&snapshot);
+
+		std::exception_ptr simulationError;
+		std::thread simulationThread([this, &simulationError] {
+			try
+			{
+				simulationLoop();
+			}
+			catch (...)
+			{
+				simulationError = std::current_exception();
+			}
+			readySnapshots.close();
+		});
+
+		auto start = std::chrono::steady_clock::now();
+		double renderMs = 0.0;
+		uint32_t frames = 0;
+
+		try
+		{
+			for (;;)
+			{
+				if (!options.headless)
+				{
+					window.handleMessages();
+					if (!::g_running)
+						break;
+					pollLatencyKeys();
+					publishInput();
+				}
+
+				FrameSnapshot* snapshot = nullptr;
+				if (!readySnapshots.pop(snapshot))
+					break;
+
+				auto renderStart = std::chrono::steady_clock::now();
+				renderer->getBatch().swap(snapshot->batch);
+				renderer->drawFrame(snapshot->input);
+				renderMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+				frames++;
+
+				freeSnapshots.push(snapshot);
+			}
+		}
+		catch (...)
+		{
+			freeSnapshots.close();
+			readySnapshots.close();
+			simulationThread.join();
+			throw;
+		}
+
+		// Both queues, the simulation thread may be blocked on either side when the window closes
+		freeSnapshots.close();
+		readySnapshots.close();
+		simulationThread.join();
+		renderer->waitIdle();
+
+		if (simulationError)
+			std::rethrow_exception(simulationError);
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (options.headless)
+			reportFrames(frames, seconds);
+		if (frames > 0)
+		{
+			std::cout << "pipeline: depth " << options.pipelineDepth << ", simulation " << simulationMs / frames << " ms, render "
+				<< renderMs / frames << " ms, frame " << seconds * 1000.0 / frames << " ms" << std::endl;
+		}
+	}
+
+	void FirstApp::simulationLoop()
+	{
+		jobs.attachThread();
+
+		auto last = std::chrono::steady_clock::now();
+		for (uint32_t frame = 0; !options.headless || frame < options.frames; frame++)
+		{
+			FrameSnapshot* snapshot = nullptr;
+			if (!freeSnapshots.pop(snapshot))
+				return;
+
+			auto now = std::chrono::steady_clock::now();
+			snapshot->input = simulateFrame(std::chrono::duration<double>(now - last).count());
+			last = now;
+
+			buildScene(snapshot->batch);
+			simulationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count();
+
+			if (!readySnapshots.push(snapshot))
+				return;
+		}
+	}
+
+	void FirstApp::reportFrames(uint32_t frames, double seconds) const
+	{
+		std::cout << "headless: " << frames << " frames at " << options.width << "x" << options.height
+			<< " in " << seconds << "s (" << (seconds > 0.0 ? frames / seconds : 0.0) << " fps)" << std::endl;
+
+		if (options.stressQuads > 0 && seconds > 0.0)
+			std::cout << "stress: " << options.stressQuads << " quads per frame, " << options.stressQuads * (frames / seconds) << " quads/s" << std::endl;
+	}
+
+	InputTimestamp FirstApp::simulateFrame(double seconds)
+	{
+		if (options.headless)
+		{
+			// Simulated time advances by a fixed amount per frame, so headless runs are reproducible
+			for (uint32_t t = 0; t < BePongSim::TICK_RATE / 60; t++)
+				stepSim(autoPongInput(sim.current()));
+			return 0;
+		}
+
+		// Taken before the input is read, so an event published in between can't be credited to this frame
+		InputTimestamp input = pendingInput.exchange(0);
+		bool recording = !options.recordPath.empty();
+		uint32_t tick = sim.current().tick;
+
+		PongInput pongInput;
+		if (recording)
+		{
+			// The paddle direction and the key events that led to it are taken together, so the log holds exactly
+			// the events the ticks below see
+			std::lock_guard<std::mutex> lock(inputMutex);
+			pongInput = readInput();
+			for (const auto& key : publishedKeys)
+				inputRecorder.key(tick, key);
+			publishedKeys.clear();
+		}
+		else
+		{
+			pongInput = readInput();
+		}
+
+		uint32_t ticks = sim.takeTicks(seconds);
+		uint32_t hashes[BePongSim::MAX_TICKS_PER_ADVANCE];
+		// The extra balls step with every tick, against that tick's paddles
+		for (uint32_t t = 0; t < ticks; t++)
+		{
+			sim.step(pongInput);
+			stepBalls();
+			if (recording)
+				hashes[t] = tickHash(sim.current(), balls, static_cast<uint32_t>(ballPairs.size()));
+		}
+
+		if (recording)
+			inputRecorder.frame(tick, static_cast<uint32_t>(seconds * 1e6), hashes, ticks);
+
+		// No tick consumed it, it belongs to the next frame that runs one. It is older than anything published since.
+		if (ticks == 0 && input != 0)
+		{
+			pendingInput.store(input);
+			input = 0;
+		}
+
+		return input;
+	}
+
+	void FirstApp::runRecordBenchmark()
+	{
+		const uint32_t iterations = 50;
+		uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+		std::vector<uint32_t> threadCounts;
+		for (uint32_t threads = 1; threads <= maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+
+		std::cout << "record benchmark, ms per frame (" << iterations << " iterations)" << std::endl;
+		std::cout << "draws";
+		for (uint32_t threads : threadCounts)
+			std::cout << "\t" << threads << "T";
+		std::cout << "\tspeedup" << std::endl;
+
+		for (uint32_t draws = 256; draws <= 65536; draws *= 4)
+		{
+			std::cout << draws;
+
+			double single = 0.0;
+			double best = 0.0;
+			for (uint32_t threads : threadCounts)
+			{
+				double ms = renderer->benchmarkRecording(draws, threads, iterations);
+				if (threads == 1)
+					single = best = ms;
+				best = std::min(best, ms);
+				std::cout << "\t" << ms;
+			}
+
+			std::cout << "\t" << (best > 0.0 ? single / best : 0.0) << "x" << std::endl;
+		}
+	}
+
+	void FirstApp::runSimulation()
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < options.simTicks; i++)
+			stepSim(autoPongInput(sim.current()));
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double simulated = options.simTicks * BePongSim::TICK_SECONDS;
+		const PongState& state = sim.current();
+
+		std::cout << "simulation: " << options.simTicks << " ticks (" << simulated << "s of game time) in " << seconds << "s, "
+			<< (seconds > 0.0 ? simulated / seconds : 0.0) << "x real time" << std::endl;
+		std::cout << "score " << state.score[0] << ":" << state.score[1] << ", state hash " << std::hex << hashPongState(state) << std::dec << std::endl;
+	}
+
+	void FirstApp::runBallBenchmark()
+	{
+		const uint64_t ballTicks = 20000000;
+		const Fixed paddleY[2] = { 0, 0 };
+
+		std::vector<SimdLevel> levels;
+		for (int level = 0; level <= static_cast<int>(options.simd); level++)
+			levels.push_back(static_cast<SimdLevel>(level));
+
+		std::cout << "ball benchmark, million balls per second (step / write instances)" << std::endl;
+		std::cout << "balls";
+		for (SimdLevel level : levels)
+			std::cout << "\t" << simdLevelName(level);
+		std::cout << std::endl;
+
+		for (uint32_t count = 1000; count <= 1000000; count *= 10)
+		{
+			// Roughly the same number of ball updates for every size
+			uint32_t ticks = static_cast<uint32_t>(std::max<uint64_t>(ballTicks / count, 10));
+			std::vector<renderer::QuadInstance> instances(count);
+			BeBallField reference;
+			std::cout << count;
+
+			for (SimdLevel level : levels)
+			{
+				BeBallField field;
+				field.spawn(count, options.seed);
+
+				auto start = std::chrono::steady_clock::now();
+				for (uint32_t t = 0; t < ticks; t++)
+					field.step(paddleY, level);
+				double stepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				start = std::chrono::steady_clock::now();
+				for (uint32_t t = 0; t < ticks; t++)
+					field.writeInstances(instances.data(), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), level);
+				double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				double updates = static_cast<double>(count) * ticks / 1e6;
+				std::cout << "\t" << (stepSeconds > 0.0 ? updates / stepSeconds : 0.0) << " / " << (writeSeconds > 0.0 ? updates / writeSeconds : 0.0);
+
+				// Every level has to end in exactly the state the scalar reference reaches
+				if (level == SimdLevel::Scalar)
+				{
+					reference = field;
+				}
+				else if (memcmp(field.positionsX(), reference.positionsX(), count * sizeof(Fixed)) != 0 ||
+					memcmp(field.positionsY(), reference.positionsY(), count * sizeof(Fixed)) != 0 ||
+					memcmp(field.velocitiesX(), reference.velocitiesX(), count * sizeof(Fixed)) != 0 ||
+					memcmp(field.velocitiesY(), reference.velocitiesY(), count * sizeof(Fixed)) != 0)
+				{
+					throw std::runtime_error(std::string(simdLevelName(level)) + " ball kernel diverged from the scalar reference");
+				}
+			}
+
+			std::cout << std::endl;
+		}
+	}
+
+	void FirstApp::runGridBenchmark()
+	{
+		const uint32_t iterations = 10;
+
+		std::cout << "grid benchmark, ms per fixed step (" << iterations << " iterations, brute force once)" << std::endl;
+		std::cout << "balls\tpairs\tbrute\tgrid 1T\tgrid " << jobs.getThreadCount() << "T\tspeedup" << std::endl;
+
+		for (uint32_t count = 1000; count <= 100000; count *= 10)
+		{
+			// A few ticks so the spawn pattern doesn't decide the layout
+			BeBallField field;
+			field.spawn(count, options.seed);
+			const Fixed paddleY[2] = { 0, 0 };
+			for (int t = 0; t < 60; t++)
+				field.step(paddleY, options.simd);
+
+			std::vector<BallPair> brute;
+			auto start = std::chrono::steady_clock::now();
+			findPairsBruteForce(field.positionsX(), field.positionsY(), count, brute);
+			double bruteMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			double gridMs[2] = {};
+			BeJobSystem* runJobs[2] = { nullptr, &jobs };
+			std::vector<BallPair> pairs;
+			for (int run = 0; run < 2; run++)
+			{
+				start = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i < iterations; i++)
+				{
+					pairs.clear();
+					grid.build(field.positionsX(), field.positionsY(), count, runJobs[run]);
+					grid.findPairs(field.positionsX(), field.positionsY(), pairs, runJobs[run]);
+				}
+				gridMs[run] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+			}
+
+			// Same pairs as the brute force search, once both are in (a, b) order
+			for (auto& pair : pairs)
+			{
+				if (pair.a > pair.b)
+					std::swap(pair.a, pair.b);
+			}
+			std::sort(pairs.begin(), pairs.end(), [](const BallPair& l, const BallPair& r) { return l.a != r.a ? l.a < r.a : l.b < r.b; });
+			if (pairs.size() != brute.size() || !std::equal(pairs.begin(), pairs.end(), brute.begin(), [](const BallPair& l, const BallPair& r) { return l.a == r.a && l.b == r.b; }))
+				throw std::runtime_error("grid broadphase missed or invented ball pairs");
+
+			double best = std::min(gridMs[0], gridMs[1]);
+			std::cout << count << "\t" << brute.size() << "\t" << bruteMs << "\t" << gridMs[0] << "\t" << gridMs[1]
+				<< "\t" << (best > 0.0 ? bruteMs / best : 0.0) << "x" << std::endl;
+		}
+	}
+
+	void FirstApp::runJobBenchmark()
+	{
+		// One frame of the chaos mode without the GPU: step and collide the balls, then fill their instances
+		const uint32_t ballCount = std::max(options.balls, 100000u);
+		const uint32_t iterations = 20;
+		uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+		std::vector<uint32_t> threadCounts;
+		for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(maxThreads);
+
+		std::cout << "job benchmark, " << ballCount << " balls, ms per frame (" << iterations << " iterations)" << std::endl;
+		std::cout << "threads\tstep\tgrid\tfill\ttotal\tspeedup\tstolen" << std::endl;
+
+		std::vector<renderer::QuadInstance> instances(ballCount);
+		std::vector<BallPair> pairs;
+		BeSpatialGrid benchGrid;
+		double single = 0.0;
+
+		for (uint32_t threads : threadCounts)
+		{
+			BeJobSystem benchJobs;
+			benchJobs.init(threads);
+
+			BeBallField field;
+			field.spawn(ballCount, options.seed);
+			const Fixed paddleY[2] = { 0, 0 };
+			double ms[3] = {};
+
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				field.step(paddleY, options.simd, &benchJobs);
+				auto stepped = std::chrono::steady_clock::now();
+
+				pairs.clear();
+				benchGrid.build(field.positionsX(), field.positionsY(), ballCount, &benchJobs);
+				benchGrid.findPairs(field.positionsX(), field.positionsY(), pairs, &benchJobs);
+				field.collide(pairs);
+				auto collided = std::chrono::steady_clock::now();
+
+				field.writeInstances(instances.data(), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), options.simd, &benchJobs);
+				auto filled = std::chrono::steady_clock::now();
+
+				ms[0] += std::chrono::duration<double, std::milli>(stepped - start).count();
+				ms[1] += std::chrono::duration<double, std::milli>(collided - stepped).count();
+				ms[2] += std::chrono::duration<double, std::milli>(filled - collided).count();
+			}
+
+			double total = (ms[0] + ms[1] + ms[2]) / iterations;
+			if (threads == 1)
+				single = total;
+
+			std::cout << threads << "\t" << ms[0] / iterations << "\t" << ms[1] / iterations << "\t" << ms[2] / iterations << "\t" << total
+				<< "\t" << (total > 0.0 ? single / total : 0.0) << "x\t" << benchJobs.getStolenJobs() << std::endl;
+		}
+	}
+
+	void FirstApp::stepSim(const PongInput& input)
+	{
+		sim.step(input);
+		stepBalls();
+	}
+
+	void FirstApp::stepBalls()
+	{
+		balls.step(sim.current().paddleY, options.simd, &jobs);
+
+		if (options.ballCollisions && balls.size() > 1)
+		{
+			ballPairs.clear();
+			grid.build(balls.positionsX(), balls.positionsY(), balls.size(), &jobs);
+			grid.findPairs(balls.positionsX(), balls.positionsY(), ballPairs, &jobs);
+			balls.collide(ballPairs);
+		}
+	}
+
+	void FirstApp::publishInput()
+	{
+		int8_t move = static_cast<int8_t>((::g_keys['S'] ? 1 : 0) - (::g_keys['W'] ? 1 : 0));
+		if (!options.recordPath.empty())
+		{
+			std::lock_guard<std::mutex> lock(inputMutex);
+			publishedKeys.insert(publishedKeys.end(), windowKeys.begin(), windowKeys.end());
+			windowKeys.clear();
+			playerMove.store(move, std::memory_order_relaxed);
+		}
+		else
+		{
+			playerMove.store(move, std::memory_order_relaxed);
+		}
+
+		// Keeps the oldest input the simulation hasn't consumed yet
+		if (::g_inputTime != 0)
+		{
+			InputTimestamp expected = 0;
+			pendingInput.compare_exchange_strong(expected, ::g_inputTime);
+			::g_inputTime = 0;
+		}
+	}
+
+	void FirstApp::pollLatencyKeys()
+	{
+#ifdef _WIN32
+		// Held keys don't rebuild again, the mode already matches
+		renderer::LatencyMode mode = renderer->getLatencyMode();
+		if (::g_keys[VK_F1])
+			mode = renderer::LatencyMode::Balanced;
+		else if (::g_keys[VK_F2])
+			mode = renderer::LatencyMode::LowLatency;
+		else if (::g_keys[VK_F3])
+			mode = renderer::LatencyMode::Throughput;
+
+		if (mode != renderer->getLatencyMode())
+			renderer->setLatencyMode(mode);
+#endif
+	}
+
+	PongInput FirstApp::readInput() const
+	{
+		// Left paddle is the player (W/S), right paddle is driven by the AI
+		PongInput input = autoPongInput(sim.current());
+		input.left = playerMove.load(std::memory_order_relaxed);
+		return input;
+	}
+
+	void FirstApp::buildScene(renderer::BeQuadBatch& batch)
+	{
+		batch.begin();
+		frameCount++;
+
+		if (options.stressQuads > 0)
+		{
+			buildStressScene(batch);
+			return;
+		}
+
+		const glm::vec4 white = { 1.0f, 1.0f, 1.0f, 1.0f };
+		const glm::vec4 grey = { 0.4f, 0.4f, 0.4f, 1.0f };
+
+		const PongState& previous = sim.previous();
+		const PongState& current = sim.current();
+		float alpha = sim.alpha();
+		auto lerp = [alpha](Fixed a, Fixed b) { return fixedToFloat(a) + (fixedToFloat(b) - fixedToFloat(a)) * alpha; };
+
+		for (int i = 0; i < 20; i++)
+			batch.submit({ 0.0f, -0.95f + i * 0.1f }, { 0.01f, 0.05f }, grey);
+
+		glm::vec2 paddleSize = { 2.0f * fixedToFloat(pong::PADDLE_HALF_WIDTH), 2.0f * fixedToFloat(pong::PADDLE_HALF_HEIGHT) };
+		batch.submit({ -fixedToFloat(pong::PADDLE_X), lerp(previous.paddleY[0], current.paddleY[0]) }, paddleSize, white);
+		batch.submit({ fixedToFloat(pong::PADDLE_X), lerp(previous.paddleY[1], current.paddleY[1]) }, paddleSize, white);
+
+		// Don't interpolate across a reset, the ball would streak through the field for a frame
+		glm::vec2 ball = current.serveDelay > 0
+			? glm::vec2(fixedToFloat(current.ballX), fixedToFloat(current.ballY))
+			: glm::vec2(lerp(previous.ballX, current.ballX), lerp(previous.ballY, current.ballY));
+		batch.submit(ball, { 2.0f * fixedToFloat(pong::BALL_HALF_WIDTH), 2.0f * fixedToFloat(pong::BALL_HALF_HEIGHT) }, white);
+
+		if (balls.size() > 0)
+			balls.writeInstances(batch.allocate(balls.size()), { 1.0f, 0.6f, 0.2f, 1.0f }, options.simd, &jobs);
+
+		batch.submitNumber(current.score[0], { -0.25f, -0.75f }, 0.2f, white);
+		batch.submitNumber(current.score[1], { 0.25f, -0.75f }, 0.2f, white);
+	}
+
+	void FirstApp::buildStressScene(renderer::BeQuadBatch& batch)
+	{
+		auto* quads = batch.allocate(options.stressQuads);
+		const uint32_t quadsPerJob = 16384;
+
+		jobs.parallelFor(options.stressQuads, quadsPerJob, [this, quads, quadsPerJob](uint32_t begin, uint32_t end) {
+			// Cheap LCG reseeded per frame and range, so every frame uploads different instance data
+			uint32_t state = (static_cast<uint32_t>(frameCount) * 747796405u + 2891336453u) ^ (begin / quadsPerJob * 2654435761u);
+			auto next = [&state]() {
+				state = state * 1664525u + 1013904223u;
+				return (state >> 8) * (1.0f / 16777216.0f);
+			};
+
+			for (uint32_t i = begin; i < end; i++)
+			{
+				quads[i].position = { next() * 2.0f - 1.0f, next() * 2.0f - 1.0f };
+				quads[i].size = { 0.01f, 0.01f };
+				quads[i].color = { next(), next(), next(), 1.0f };
+				quads[i].uvRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+			}
+		});
 	}
 
 }
\ No newline at end of file
@@ -2,9 +2,82 @@
 
 #include "be_window.h"
 #include "be_renderer.h"
+#include "be_pong.h"
+#include "be_balls.h"
+#include "be_queue.h"
+#include "be_replay.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace be 
 {
+
+	struct AppOptions
+	{
+		bool headless = false;
+		uint32_t width = 800;
+		uint32_t height = 600;
+		uint32_t frames = 1000;
+		uint32_t imageCount = 3;
+		// Quads submitted per frame in stress mode, 0 renders the normal scene
+		uint32_t stressQuads = 0;
+		// Secondary command buffers recorded per frame as jobs, 0 records inline on the main thread
+		uint32_t recordThreads = 0;
+		// Times command recording for growing draw and thread counts instead of rendering, implies headless
+		bool benchRecord = false;
+		uint32_t seed = 1;
+		// Runs this many simulation ticks without rendering and reports the speed against real time
+		uint32_t simTicks = 0;
+		// Extra balls simulated alongside the game and drawn from the SoA kernels
+		uint32_t balls = 0;
+		// Times the ball kernels for every supported SIMD level instead of rendering
+		bool benchBalls = false;
+		SimdLevel simd = detectSimdLevel();
+		// Lets the extra balls bounce off each other through the spatial grid
+		bool ballCollisions = false;
+		// Threads of the job system, including the main thread, 0 uses every hardware thread
+		uint32_t jobThreads = 0;
+		// Times the job driven frame work for 1 to all hardware threads instead of rendering
+		bool benchJobs = false;
+		// Times the grid broadphase against the brute force pair search instead of rendering
+		bool benchGrid = false;
+		// Frame snapshots in flight between the simulation thread and the render thread (2 double, 3 triple
+		// buffered), 0 simulates and renders in turn on the main thread
+		uint32_t pipelineDepth = 0;
+		// Frames in flight, swapchain images and present mode, F1/F2/F3 switch between them while running
+		renderer::LatencyMode latency = renderer::LatencyMode::Balanced;
+		// Uses Vulkan 1.3 dynamic rendering where the device supports it, render pass objects otherwise
+		bool dynamicRendering = true;
+		// Tracks frames on a timeline semaphore where supported, with a fence per frame in flight otherwise
+		bool timelineSync = true;
+		// Writes the key events of a windowed match and the state after every tick to this file
+		::std::string recordPath;
+		// Plays a recorded match back headless, stopping at the first tick that doesn't match the recording. Seed,
+		// balls and collisions come from the log.
+		::std::string replayPath;
+		// Paces the replay like the recorded frames instead of running it as fast as possible
+		bool replayRealTime = false;
+		// Writes every rendered frame into this directory, as PNG or as raw pixels
+		::std::string captureDirectory;
+		bool captureRaw = false;
+		// Renders the scripted regression scenes headless, preferring a software device, and checks them against the
+		// golden images in this directory and the scenes' thresholds
+		::std::string regressDirectory;
+		// JSON results of the regression run, results.json next to the goldens if empty
+		::std::string regressResults;
+		// Writes the golden images from this run instead of comparing against them
+		bool regressUpdate = false;
+		// Draws the regression scenes with the CPU reference rasterizer instead of a device, for goldens where no
+		// Vulkan driver is available. Only the images are checked.
+		bool regressReference = false;
+	};
+
+	AppOptions parseOptions(int argc, char** argv);
 	
 	class FirstApp
 	{
@@ -12,18 +85,100 @@ namespace be
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 600;
 
-		FirstApp() {
-			initWindow(window, WIDTH, HEIGHT, "Hello World");
+		FirstApp(const AppOptions& options = {}) : options(options), sim(options.seed) {
+			// One extra deque for the simulation thread of the pipelined loop
+			jobs.init(options.jobThreads, 1);
+			balls.spawn(options.balls, options.seed);
+
+			// The regression run creates a renderer per scene itself
+			if (options.simTicks > 0 || options.benchBalls || options.benchGrid || options.benchJobs || !options.regressDirectory.empty())
+				return;
+
+			if (options.headless)
+			{
+				renderer = ::std::make_unique<renderer::BeRenderer>(VkExtent2D{ options.width, options.height }, options.imageCount);
+			}
+			else
+			{
+				initWindow(window, WIDTH, HEIGHT, "Hello World");
+				renderer = ::std::make_unique<renderer::BeRenderer>(&window);
+			}
 
-			renderer = new renderer::BeRenderer(&window);
+			renderer->setRecordThreads(options.recordThreads);
+			renderer->setJobSystem(&jobs);
+			renderer->setLatencyMode(options.latency);
+			renderer->setDynamicRendering(options.dynamicRendering);
+			renderer->setTimelineSync(options.timelineSync);
+			if (!options.captureDirectory.empty())
+				renderer->setCapture(renderer::BeFrameCapture::fileSink(options.captureDirectory, options.captureRaw ? renderer::CaptureFormat::Raw : renderer::CaptureFormat::Png));
 			renderer->init();
+
+			if (!options.recordPath.empty())
+			{
+				inputRecorder.open(options.recordPath, { options.seed, options.balls, options.ballCollisions });
+				::g_keyLog = &windowKeys;
+			}
 		}
 
+		~FirstApp();
+
 		void run();
 
 	private:
+		void runHeadless();
+		void runReplay();
+		void runRegression();
+		void runRecordBenchmark();
+		void runSimulation();
+		void runBallBenchmark();
+		void runGridBenchmark();
+		void runJobBenchmark();
+		void stepSim(const PongInput& input);
+		void stepBalls();
+		void runPipelined();
+		void simulationLoop();
+		void reportFrames(uint32_t frames, double seconds) const;
+		// Returns the oldest input the ticks of this frame consumed, 0 if none
+		InputTimestamp simulateFrame(double seconds);
+		void publishInput();
+		void pollLatencyKeys();
+		PongInput readInput() const;
+		void buildScene(renderer::BeQuadBatch& batch);
+		void buildStressScene(renderer::BeQuadBatch& batch);
+
+		AppOptions options;
 		BeWindow window = {};
-		renderer::BeRenderer* renderer;
+		// Owned from construction, so a throwing init still tears down what it created
+		::std::unique_ptr<renderer::BeRenderer> renderer;
+		BeJobSystem jobs;
+		BePongSim sim;
+		BeBallField balls;
+		BeSpatialGrid grid;
+		::std::vector<BallPair> ballPairs;
+		uint64_t frameCount = 0;
+
+		// A game frame built by the simulation thread, ready to be swapped into the renderer's batch
+		struct FrameSnapshot
+		{
+			renderer::BeQuadBatch batch;
+			InputTimestamp input = 0;
+		};
+
+		::std::vector<FrameSnapshot> snapshots;
+		BeBoundedQueue<FrameSnapshot*> freeSnapshots;
+		BeBoundedQueue<FrameSnapshot*> readySnapshots;
+		// Player paddle direction sampled by the window thread, read by the simulation
+		::std::atomic<int8_t> playerMove{ 0 };
+		// Oldest input published but not yet consumed by a simulation tick
+		::std::atomic<InputTimestamp> pendingInput{ 0 };
+		double simulationMs = 0.0;
+
+		BeInputRecorder inputRecorder;
+		// Key events from the message loop since the last publishInput, and those published but not yet seen by a tick
+		::std::vector<KeyEvent> windowKeys;
+		::std::vector<KeyEvent> publishedKeys;
+		// Hands publishedKeys and playerMove to the simulation together while recording
+		::std::mutex inputMutex;
 	};
 
 }
\ No newline at end of file
@@ -1,29 +1,19 @@
-
 #include "first_app.h"
 
+#ifdef _WIN32
 #define NOMINMAX
 #include <Windows.h>
+#endif
 
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR cmdLine, int cmdShow)
+static int runApp(int argc, char** argv)
 {
-
-#ifdef _DEBUG
-	AllocConsole();
-	freopen("CONIN%", "r", stdin);
-	freopen("CONOUT$", "w", stdout);
-	freopen("CONOUT$", "w", stderr);
-	std::cout.sync_with_stdio();
-#endif // _DEBUG
-
-
-	be::FirstApp app;
-
 	try
 	{
+		be::FirstApp app(be::parseOptions(argc, argv));
 		app.run();
 	}
 	catch (const std::exception& e)
@@ -33,4 +23,25 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR cmdLine,
 	}
 
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+#ifdef _WIN32
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR cmdLine, int cmdShow)
+{
+
+#ifdef _DEBUG
+	AllocConsole();
+	freopen("CONIN%", "r", stdin);
+	freopen("CONOUT$", "w", stdout);
+	freopen("CONOUT$", "w", stderr);
+	std::cout.sync_with_stdio();
+#endif // _DEBUG
+
+	return runApp(__argc, __argv);
+}
+#else
+int main(int argc, char** argv)
+{
+	return runApp(argc, argv);
+}
+#endif
\ No newline at end of file
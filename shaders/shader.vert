@@ -1,20 +1,20 @@
 #version 450
 
-layout(location = 0) out vec3 fragColor;
+// Unit quad, per vertex
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUV;
 
-vec2 positions[3] = vec2[](
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
+// QuadInstance, per instance
+layout(location = 2) in vec2 instPosition;
+layout(location = 3) in vec2 instSize;
+layout(location = 4) in vec4 instColor;
+layout(location = 5) in vec4 instUVRect;
 
-vec3 colors[3] = vec3[](
-	vec3(1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragUV;
 
 void main() {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+	gl_Position = vec4(instPosition + inPosition * instSize, 0.0, 1.0);
+	fragColor = instColor;
+	fragUV = instUVRect.xy + inUV * instUVRect.zw;
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "be_jobs.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what)
+{
+	if (!condition)
+	{
+		std::cerr << "FAILED: " << what << std::endl;
+		failures++;
+	}
+}
+
+// Far more jobs per fork than the deque and the job ring hold, so pushes overflow into inline jobs while thieves
+// still hold ring slots
+static void forkOverflow(be::BeJobSystem& jobs, uint32_t count)
+{
+	std::atomic<uint64_t> sum{ 0 };
+	jobs.parallelFor(count, 1, [&sum](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++)
+			sum.fetch_add(1, std::memory_order_relaxed);
+	});
+	check(sum.load() == count, std::to_string(jobs.getThreadCount()) + " threads, " + std::to_string(count) + " single item jobs summed to " + std::to_string(sum.load()));
+}
+
+// Jobs that fork again from the job threads, every level overflowing its deque
+static void forkNested(be::BeJobSystem& jobs)
+{
+	const uint32_t outer = 16;
+	const uint32_t inner = 10000;
+	std::atomic<uint64_t> sum{ 0 };
+	jobs.parallelFor(outer, 1, [&jobs, &sum](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++)
+		{
+			jobs.parallelFor(inner, 1, [&sum, i](uint32_t innerBegin, uint32_t innerEnd) {
+				for (uint32_t j = innerBegin; j < innerEnd; j++)
+					sum.fetch_add(i, std::memory_order_relaxed);
+			});
+		}
+	});
+
+	uint64_t expected = static_cast<uint64_t>(inner) * (outer * (outer - 1) / 2);
+	check(sum.load() == expected, std::to_string(jobs.getThreadCount()) + " threads, nested forks summed to " + std::to_string(sum.load()) + " instead of " + std::to_string(expected));
+}
+
+static void exceptionsPropagate(be::BeJobSystem& jobs)
+{
+	bool caught = false;
+	try
+	{
+		jobs.parallelFor(20000, 1, [](uint32_t begin, uint32_t) {
+			if (begin == 12345)
+				throw std::runtime_error("range failed");
+		});
+	}
+	catch (const std::runtime_error&)
+	{
+		caught = true;
+	}
+	check(caught, std::to_string(jobs.getThreadCount()) + " threads, exception of an overflowing fork not rethrown");
+}
+
+int main()
+{
+	for (uint32_t threads : { 2u, 4u, 8u })
+	{
+		be::BeJobSystem jobs;
+		jobs.init(threads);
+
+		for (int round = 0; round < 3; round++)
+			forkOverflow(jobs, 1000000);
+		forkOverflow(jobs, be::BeJobSystem::QUEUE_CAPACITY * 2 + 1);
+		forkNested(jobs);
+		exceptionsPropagate(jobs);
+	}
+
+	if (failures > 0)
+		return EXIT_FAILURE;
+
+	std::cout << "jobs: all tests passed" << std::endl;
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "first_app.h"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+// The golden image and performance regression run of the game as a test of its own. Takes the game's options, e.g.
+// --regress-update to write new goldens after an intended change in output.
+int main(int argc, char** argv)
+{
+	try
+	{
+		be::AppOptions options = be::parseOptions(argc, argv);
+		if (options.regressDirectory.empty())
+			throw std::runtime_error("Usage: test_regress --regress <golden dir> [--regress-results <file>] [--regress-update] [--regress-reference]");
+
+		be::FirstApp app(options);
+		app.run();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
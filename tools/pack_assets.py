@@ -0,0 +1,140 @@
+"""Builds the asset pack loaded by be::BeAssetPack.
+
+Usage: pack_assets.py -o assets.pack [--compress-min-size BYTES] name=path [name=path ...]
+
+Layout (little endian):
+    header  : magic "BEPK", u32 version, u32 entry count, u32 reserved
+    entries : char name[48], u32 offset, u32 stored size, u32 raw size, u32 flags
+    data    : each entry starts on a 4 byte boundary
+
+Entries at least --compress-min-size bytes long are stored as raw LZ4 blocks (flag 1) when that saves space.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"BEPK"
+VERSION = 1
+FLAG_LZ4 = 1
+NAME_SIZE = 48
+HEADER = struct.Struct("<4sIII")
+ENTRY = struct.Struct("<%dsIIII" % NAME_SIZE)
+
+MIN_MATCH = 4
+# The format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+LAST_LITERALS = 5
+MF_LIMIT = 12
+
+
+def _write_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def _write_sequence(out, literals, match_length, offset):
+    literal_length = len(literals)
+    token = min(literal_length, 15) << 4
+    if match_length is not None:
+        token |= min(match_length - MIN_MATCH, 15)
+    out.append(token)
+    if literal_length >= 15:
+        _write_length(out, literal_length - 15)
+    out += literals
+    if match_length is not None:
+        out += struct.pack("<H", offset)
+        if match_length - MIN_MATCH >= 15:
+            _write_length(out, match_length - MIN_MATCH - 15)
+
+
+def lz4_compress_block(data):
+    """Greedy single-probe LZ4 block compressor, good enough for build time packing."""
+    out = bytearray()
+    size = len(data)
+    table = {}
+    anchor = 0
+    pos = 0
+    match_limit = size - MF_LIMIT
+
+    while pos < match_limit:
+        key = data[pos:pos + MIN_MATCH]
+        candidate = table.get(key)
+        table[key] = pos
+
+        if candidate is None or pos - candidate > 0xFFFF:
+            pos += 1
+            continue
+
+        match_length = MIN_MATCH
+        max_length = size - LAST_LITERALS - pos
+        while match_length < max_length and data[candidate + match_length] == data[pos + match_length]:
+            match_length += 1
+
+        _write_sequence(out, data[anchor:pos], match_length, pos - candidate)
+        pos += match_length
+        anchor = pos
+
+    _write_sequence(out, data[anchor:], None, 0)
+    return bytes(out)
+
+
+def build_pack(entries, compress_min_size):
+    data_start = HEADER.size + ENTRY.size * len(entries)
+    offset = (data_start + 3) & ~3
+
+    table = bytearray()
+    blobs = bytearray(offset - data_start)
+
+    for name, raw in entries:
+        encoded = name.encode("utf-8")
+        if len(encoded) >= NAME_SIZE:
+            raise ValueError("asset name too long: %s" % name)
+
+        stored, flags = raw, 0
+        if compress_min_size >= 0 and len(raw) >= compress_min_size:
+            compressed = lz4_compress_block(raw)
+            if len(compressed) < len(raw):
+                stored, flags = compressed, FLAG_LZ4
+
+        table += ENTRY.pack(encoded, offset, len(stored), len(raw), flags)
+        blobs += stored
+
+        padding = (-len(stored)) % 4
+        blobs += bytes(padding)
+        offset += len(stored) + padding
+
+    return HEADER.pack(MAGIC, VERSION, len(entries), 0) + bytes(table) + bytes(blobs)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--compress-min-size", type=int, default=64 * 1024,
+                        help="LZ4 compress entries of at least this many bytes, -1 disables compression")
+    parser.add_argument("assets", nargs="+", help="name=path pairs")
+    args = parser.parse_args()
+
+    entries = []
+    for asset in args.assets:
+        name, _, path = asset.partition("=")
+        if not path:
+            parser.error("expected name=path, got %s" % asset)
+        with open(path, "rb") as f:
+            entries.append((name.replace("\\", "/"), f.read()))
+
+    pack = build_pack(entries, args.compress_min_size)
+
+    tmp = args.output + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(pack)
+    os.replace(tmp, args.output)
+
+    print("packed %d assets into %s (%d bytes)" % (len(entries), args.output, len(pack)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
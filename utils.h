@@ -1,23 +1,55 @@
 #pragma once
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <unistd.h>
+#include <climits>
+#endif
+
+#include <cstdio>
 #include <fstream>
-#include <stdexcept>
-#include <vector>
+#include <string>
 
-static std::vector<char> readFile(const std::string& filename)
+// Directory of the running executable, with a trailing separator
+static std::string getExecutableDir()
 {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+#ifdef _WIN32
+	char path[MAX_PATH];
+	DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+	std::string exePath(path, length);
+#else
+	char path[PATH_MAX];
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+	std::string exePath(path, length > 0 ? static_cast<size_t>(length) : 0);
+#endif
+
+	size_t separator = exePath.find_last_of("\\/");
+	if (separator == std::string::npos)
+		return std::string();
 
-	if (!file.is_open())
-		throw std::runtime_error("Filed to open file");
+	return exePath.substr(0, separator + 1);
+}
 
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
+// Writes to a temporary file first and renames it over filename, so readers never see a partial file
+static bool writeFileAtomic(const std::string& filename, const void* data, size_t size)
+{
+	std::string tmpName = filename + ".tmp";
 
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
+	{
+		std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
 
-	file.close();
+		file.write(static_cast<const char*>(data), size);
+		if (!file.good())
+			return false;
+	}
 
-	return buffer;
-}
\ No newline at end of file
+#ifdef _WIN32
+	return MoveFileExA(tmpName.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(tmpName.c_str(), filename.c_str()) == 0;
+#endif
+}